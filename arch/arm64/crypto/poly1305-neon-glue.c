@@ -0,0 +1,634 @@
+/*
+ * Poly1305 authenticator and ChaCha20-Poly1305 AEAD, RFC7539, arm64 NEON
+ * functions
+ *
+ * Based on:
+ * Poly1305 authenticator algorithm, RFC7539, SIMD glue code
+ *
+ * Copyright (C) 2015 Martin Willi
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <crypto/algapi.h>
+#include <crypto/chacha20.h>
+#include <crypto/internal/aead.h>
+#include <crypto/internal/hash.h>
+#include <crypto/internal/skcipher.h>
+#include <crypto/poly1305.h>
+#include <crypto/scatterwalk.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+
+#include <asm/hwcap.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+#include <asm/unaligned.h>
+
+#define CHACHAPOLY_IV_SIZE	12
+
+/* kernel_neon_begin/end is costly, use the generic code below this */
+#define POLY1305_NEON_MIN_UPDATE	288
+
+asmlinkage void poly1305_4block_neon(u32 *h, const u8 *src, const u32 *key,
+				     unsigned int blocks);
+asmlinkage void chacha20poly1305_block_xor_neon(u32 *state, u8 *dst,
+						const u8 *src);
+asmlinkage void chacha20poly1305_4block_xor_neon(u32 *state, u8 *dst,
+						 const u8 *src);
+
+/* Per limb { r^4, r^3, r^2, r }, then the same times 5 for limbs 1 to 4 */
+struct poly1305_neon_key {
+	u32 pow[9][4];
+};
+
+struct poly1305_neon_desc_ctx {
+	struct poly1305_desc_ctx base;
+	/* key powers set? */
+	bool pset;
+	struct poly1305_neon_key key;
+};
+
+/* h = a * b mod 2^130 - 5, all in 26 bit limbs, h may alias a or b */
+static void poly1305_mul(u32 *h, const u32 *a, const u32 *b)
+{
+	u32 s1 = b[1] * 5, s2 = b[2] * 5, s3 = b[3] * 5, s4 = b[4] * 5;
+	u64 d0, d1, d2, d3, d4;
+
+	d0 = (u64)a[0] * b[0] + (u64)a[1] * s4 + (u64)a[2] * s3 +
+	     (u64)a[3] * s2 + (u64)a[4] * s1;
+	d1 = (u64)a[0] * b[1] + (u64)a[1] * b[0] + (u64)a[2] * s4 +
+	     (u64)a[3] * s3 + (u64)a[4] * s2;
+	d2 = (u64)a[0] * b[2] + (u64)a[1] * b[1] + (u64)a[2] * b[0] +
+	     (u64)a[3] * s4 + (u64)a[4] * s3;
+	d3 = (u64)a[0] * b[3] + (u64)a[1] * b[2] + (u64)a[2] * b[1] +
+	     (u64)a[3] * b[0] + (u64)a[4] * s4;
+	d4 = (u64)a[0] * b[4] + (u64)a[1] * b[3] + (u64)a[2] * b[2] +
+	     (u64)a[3] * b[1] + (u64)a[4] * b[0];
+
+	d1 += d0 >> 26;
+	d2 += d1 >> 26;
+	d3 += d2 >> 26;
+	d4 += d3 >> 26;
+	h[0] = (d0 & 0x3ffffff) + (u32)(d4 >> 26) * 5;
+	h[1] = (d1 & 0x3ffffff) + (h[0] >> 26);
+	h[0] &= 0x3ffffff;
+	h[2] = d2 & 0x3ffffff;
+	h[3] = d3 & 0x3ffffff;
+	h[4] = d4 & 0x3ffffff;
+}
+
+static void poly1305_scalar_blocks(u32 *h, const u32 *r, const u8 *src,
+				   unsigned int blocks)
+{
+	while (blocks--) {
+		h[0] += (get_unaligned_le32(src +  0) >> 0) & 0x3ffffff;
+		h[1] += (get_unaligned_le32(src +  3) >> 2) & 0x3ffffff;
+		h[2] += (get_unaligned_le32(src +  6) >> 4) & 0x3ffffff;
+		h[3] += (get_unaligned_le32(src +  9) >> 6) & 0x3ffffff;
+		h[4] += (get_unaligned_le32(src + 12) >> 8) | (1 << 24);
+		poly1305_mul(h, h, r);
+		src += POLY1305_BLOCK_SIZE;
+	}
+}
+
+static void poly1305_neon_setkey(struct poly1305_neon_key *key, const u32 *r)
+{
+	u32 pow[4][5];
+	int i, j;
+
+	memcpy(pow[3], r, sizeof(pow[3]));
+	poly1305_mul(pow[2], r, r);
+	poly1305_mul(pow[1], pow[2], r);
+	poly1305_mul(pow[0], pow[2], pow[2]);
+
+	for (i = 0; i < 5; i++)
+		for (j = 0; j < 4; j++)
+			key->pow[i][j] = pow[j][i];
+	for (i = 1; i < 5; i++)
+		for (j = 0; j < 4; j++)
+			key->pow[4 + i][j] = pow[j][i] * 5;
+}
+
+/* NEON needs kernel_neon_begin() around the call if @neon is set */
+static void poly1305_neon_blocks(u32 *h, const u32 *r,
+				 const struct poly1305_neon_key *key,
+				 const u8 *src, unsigned int blocks, bool neon)
+{
+	if (neon && blocks >= 4) {
+		poly1305_4block_neon(h, src, &key->pow[0][0], blocks / 4);
+		src += round_down(blocks, 4) * POLY1305_BLOCK_SIZE;
+		blocks %= 4;
+	}
+	poly1305_scalar_blocks(h, r, src, blocks);
+}
+
+/*
+ * Poly1305 shash
+ */
+static int poly1305_neon_init(struct shash_desc *desc)
+{
+	struct poly1305_neon_desc_ctx *sctx = shash_desc_ctx(desc);
+
+	sctx->pset = false;
+	return crypto_poly1305_init(desc);
+}
+
+static unsigned int poly1305_neon_do_blocks(struct poly1305_desc_ctx *dctx,
+					    const u8 *src, unsigned int srclen)
+{
+	struct poly1305_neon_desc_ctx *sctx;
+	unsigned int datalen;
+
+	BUILD_BUG_ON(offsetof(struct poly1305_neon_desc_ctx, base));
+	sctx = container_of(dctx, struct poly1305_neon_desc_ctx, base);
+
+	if (unlikely(!dctx->sset)) {
+		datalen = crypto_poly1305_setdesckey(dctx, src, srclen);
+		src += srclen - datalen;
+		srclen = datalen;
+	}
+	if (srclen < POLY1305_BLOCK_SIZE)
+		return srclen;
+
+	if (unlikely(!sctx->pset)) {
+		poly1305_neon_setkey(&sctx->key, dctx->r);
+		sctx->pset = true;
+	}
+	poly1305_neon_blocks(dctx->h, dctx->r, &sctx->key, src,
+			     srclen / POLY1305_BLOCK_SIZE, true);
+	return srclen % POLY1305_BLOCK_SIZE;
+}
+
+static int poly1305_neon_update(struct shash_desc *desc,
+				const u8 *src, unsigned int srclen)
+{
+	struct poly1305_desc_ctx *dctx = shash_desc_ctx(desc);
+	unsigned int bytes;
+
+	if (srclen <= POLY1305_NEON_MIN_UPDATE || !may_use_simd())
+		return crypto_poly1305_update(desc, src, srclen);
+
+	kernel_neon_begin();
+
+	if (unlikely(dctx->buflen)) {
+		bytes = min(srclen, POLY1305_BLOCK_SIZE - dctx->buflen);
+		memcpy(dctx->buf + dctx->buflen, src, bytes);
+		src += bytes;
+		srclen -= bytes;
+		dctx->buflen += bytes;
+
+		if (dctx->buflen == POLY1305_BLOCK_SIZE) {
+			poly1305_neon_do_blocks(dctx, dctx->buf,
+						POLY1305_BLOCK_SIZE);
+			dctx->buflen = 0;
+		}
+	}
+
+	if (likely(srclen >= POLY1305_BLOCK_SIZE)) {
+		bytes = poly1305_neon_do_blocks(dctx, src, srclen);
+		src += srclen - bytes;
+		srclen = bytes;
+	}
+
+	kernel_neon_end();
+
+	if (unlikely(srclen)) {
+		dctx->buflen = srclen;
+		memcpy(dctx->buf, src, srclen);
+	}
+
+	return 0;
+}
+
+static struct shash_alg poly1305_alg = {
+	.digestsize		= POLY1305_DIGEST_SIZE,
+	.init			= poly1305_neon_init,
+	.update			= poly1305_neon_update,
+	.final			= crypto_poly1305_final,
+	.descsize		= sizeof(struct poly1305_neon_desc_ctx),
+	.base.cra_name		= "poly1305",
+	.base.cra_driver_name	= "poly1305-neon",
+	.base.cra_priority	= 300,
+	.base.cra_blocksize	= POLY1305_BLOCK_SIZE,
+	.base.cra_module	= THIS_MODULE,
+};
+
+/*
+ * ChaCha20-Poly1305 AEAD
+ *
+ * The template runs ChaCha20 over the whole request and then Poly1305 over
+ * the result.  Here each 256 byte stride is encrypted and MACed before
+ * moving on, so the data is only pulled through the cache once.
+ */
+struct chachapoly_neon_ctx {
+	struct chacha20_ctx chacha;
+	/* key material appended to the nonce, rfc7539esp only */
+	u8 salt[CHACHAPOLY_IV_SIZE];
+	unsigned int saltlen;
+};
+
+struct chachapoly_neon_mac {
+	u32 r[5];
+	u32 s[4];
+	u32 h[5];
+	u8 buf[POLY1305_BLOCK_SIZE];
+	unsigned int buflen;
+	struct poly1305_neon_key key;
+};
+
+static void chachapoly_mac_init(struct chachapoly_neon_mac *mac,
+				const u8 *key)
+{
+	int i;
+
+	/* r &= 0xffffffc0ffffffc0ffffffc0fffffff */
+	mac->r[0] = (get_unaligned_le32(key +  0) >> 0) & 0x3ffffff;
+	mac->r[1] = (get_unaligned_le32(key +  3) >> 2) & 0x3ffff03;
+	mac->r[2] = (get_unaligned_le32(key +  6) >> 4) & 0x3ffc0ff;
+	mac->r[3] = (get_unaligned_le32(key +  9) >> 6) & 0x3f03fff;
+	mac->r[4] = (get_unaligned_le32(key + 12) >> 8) & 0x00fffff;
+
+	for (i = 0; i < 4; i++)
+		mac->s[i] = get_unaligned_le32(key + 16 + i * sizeof(u32));
+
+	memset(mac->h, 0, sizeof(mac->h));
+	mac->buflen = 0;
+	poly1305_neon_setkey(&mac->key, mac->r);
+}
+
+static void chachapoly_mac_update(struct chachapoly_neon_mac *mac,
+				  const u8 *src, unsigned int len, bool neon)
+{
+	unsigned int bytes;
+
+	if (unlikely(mac->buflen)) {
+		bytes = min(len, POLY1305_BLOCK_SIZE - mac->buflen);
+		memcpy(mac->buf + mac->buflen, src, bytes);
+		src += bytes;
+		len -= bytes;
+		mac->buflen += bytes;
+
+		if (mac->buflen < POLY1305_BLOCK_SIZE)
+			return;
+		poly1305_scalar_blocks(mac->h, mac->r, mac->buf, 1);
+		mac->buflen = 0;
+	}
+
+	if (len >= POLY1305_BLOCK_SIZE) {
+		poly1305_neon_blocks(mac->h, mac->r, &mac->key, src,
+				     len / POLY1305_BLOCK_SIZE, neon);
+		src += round_down(len, POLY1305_BLOCK_SIZE);
+		len %= POLY1305_BLOCK_SIZE;
+	}
+
+	if (len) {
+		memcpy(mac->buf, src, len);
+		mac->buflen = len;
+	}
+}
+
+/* Zero pad the data MACed so far to a multiple of the block size */
+static void chachapoly_mac_pad(struct chachapoly_neon_mac *mac)
+{
+	if (mac->buflen) {
+		memset(mac->buf + mac->buflen, 0,
+		       POLY1305_BLOCK_SIZE - mac->buflen);
+		poly1305_scalar_blocks(mac->h, mac->r, mac->buf, 1);
+		mac->buflen = 0;
+	}
+}
+
+static void chachapoly_mac_final(struct chachapoly_neon_mac *mac, u8 *dst)
+{
+	u32 h0, h1, h2, h3, h4;
+	u32 g0, g1, g2, g3, g4;
+	u32 mask;
+	u64 f = 0;
+
+	/* fully carry h */
+	h0 = mac->h[0];
+	h1 = mac->h[1];
+	h2 = mac->h[2];
+	h3 = mac->h[3];
+	h4 = mac->h[4];
+
+	h2 += (h1 >> 26);     h1 = h1 & 0x3ffffff;
+	h3 += (h2 >> 26);     h2 = h2 & 0x3ffffff;
+	h4 += (h3 >> 26);     h3 = h3 & 0x3ffffff;
+	h0 += (h4 >> 26) * 5; h4 = h4 & 0x3ffffff;
+	h1 += (h0 >> 26);     h0 = h0 & 0x3ffffff;
+
+	/* compute h + -p */
+	g0 = h0 + 5;
+	g1 = h1 + (g0 >> 26);             g0 &= 0x3ffffff;
+	g2 = h2 + (g1 >> 26);             g1 &= 0x3ffffff;
+	g3 = h3 + (g2 >> 26);             g2 &= 0x3ffffff;
+	g4 = h4 + (g3 >> 26) - (1 << 26); g3 &= 0x3ffffff;
+
+	/* select h if h < p, or h + -p if h >= p */
+	mask = (g4 >> ((sizeof(u32) * 8) - 1)) - 1;
+	g0 &= mask;
+	g1 &= mask;
+	g2 &= mask;
+	g3 &= mask;
+	g4 &= mask;
+	mask = ~mask;
+	h0 = (h0 & mask) | g0;
+	h1 = (h1 & mask) | g1;
+	h2 = (h2 & mask) | g2;
+	h3 = (h3 & mask) | g3;
+	h4 = (h4 & mask) | g4;
+
+	/* h = h % (2^128) */
+	h0 = (h0 >>  0) | (h1 << 26);
+	h1 = (h1 >>  6) | (h2 << 20);
+	h2 = (h2 >> 12) | (h3 << 14);
+	h3 = (h3 >> 18) | (h4 <<  8);
+
+	/* mac = (h + s) % (2^128) */
+	f = (f >> 32) + h0 + mac->s[0]; put_unaligned_le32(f, dst +  0);
+	f = (f >> 32) + h1 + mac->s[1]; put_unaligned_le32(f, dst +  4);
+	f = (f >> 32) + h2 + mac->s[2]; put_unaligned_le32(f, dst +  8);
+	f = (f >> 32) + h3 + mac->s[3]; put_unaligned_le32(f, dst + 12);
+}
+
+static void chachapoly_mac_assoc(struct aead_request *req,
+				 struct chachapoly_neon_mac *mac,
+				 unsigned int len, bool neon)
+{
+	struct scatter_walk walk;
+
+	if (!len)
+		return;
+
+	scatterwalk_start(&walk, req->src);
+
+	do {
+		u32 n = scatterwalk_clamp(&walk, len);
+		u8 *p;
+
+		if (!n) {
+			scatterwalk_start(&walk, sg_next(walk.sg));
+			n = scatterwalk_clamp(&walk, len);
+		}
+		p = scatterwalk_map(&walk);
+		if (neon)
+			kernel_neon_begin();
+		chachapoly_mac_update(mac, p, n, neon);
+		if (neon)
+			kernel_neon_end();
+		len -= n;
+
+		scatterwalk_unmap(p);
+		scatterwalk_advance(&walk, n);
+		scatterwalk_done(&walk, 0, len);
+	} while (len);
+
+	chachapoly_mac_pad(mac);
+}
+
+/*
+ * En/decrypt and MAC @bytes of payload.  Only the last call of a request may
+ * pass a length that is not a multiple of the ChaCha20 block size.
+ */
+static void chachapoly_crypt_mac(u32 *state, struct chachapoly_neon_mac *mac,
+				 u8 *dst, const u8 *src, unsigned int bytes,
+				 bool enc, bool neon)
+{
+	u32 stream[CHACHA20_BLOCK_WORDS];
+	u8 buf[CHACHA20_BLOCK_SIZE];
+	unsigned int n;
+
+	if (neon) {
+		kernel_neon_begin();
+		while (bytes >= CHACHA20_BLOCK_SIZE * 4) {
+			if (!enc)
+				chachapoly_mac_update(mac, src,
+						      CHACHA20_BLOCK_SIZE * 4,
+						      true);
+			chacha20poly1305_4block_xor_neon(state, dst, src);
+			if (enc)
+				chachapoly_mac_update(mac, dst,
+						      CHACHA20_BLOCK_SIZE * 4,
+						      true);
+			state[12] += 4;
+			bytes -= CHACHA20_BLOCK_SIZE * 4;
+			src += CHACHA20_BLOCK_SIZE * 4;
+			dst += CHACHA20_BLOCK_SIZE * 4;
+		}
+	}
+
+	while (bytes) {
+		n = min_t(unsigned int, bytes, CHACHA20_BLOCK_SIZE);
+		if (!enc)
+			chachapoly_mac_update(mac, src, n, neon);
+		if (neon) {
+			memcpy(buf, src, n);
+			chacha20poly1305_block_xor_neon(state, buf, buf);
+			memcpy(dst, buf, n);
+			state[12]++;
+		} else {
+			chacha20_block(state, stream);
+			crypto_xor_cpy(dst, src, (u8 *)stream, n);
+		}
+		if (enc)
+			chachapoly_mac_update(mac, dst, n, neon);
+		bytes -= n;
+		src += n;
+		dst += n;
+	}
+
+	if (neon)
+		kernel_neon_end();
+
+	memzero_explicit(stream, sizeof(stream));
+	memzero_explicit(buf, sizeof(buf));
+}
+
+static int chachapoly_neon_crypt(struct aead_request *req, bool enc)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct chachapoly_neon_ctx *ctx = crypto_aead_ctx(tfm);
+	unsigned int ivsize = crypto_aead_ivsize(tfm);
+	unsigned int cryptlen = req->cryptlen;
+	unsigned int assoclen = req->assoclen;
+	struct chachapoly_neon_mac mac;
+	struct skcipher_walk walk;
+	u32 state[16], stream[CHACHA20_BLOCK_WORDS];
+	u8 iv[CHACHA20_IV_SIZE];
+	u8 tag[2][POLY1305_DIGEST_SIZE];
+	__le64 lengths[2];
+	bool neon = may_use_simd();
+	int err;
+
+	if (!enc)
+		cryptlen -= POLY1305_DIGEST_SIZE;
+
+	/* rfc7539esp carries the IV at the end of the associated data */
+	if (ivsize != CHACHAPOLY_IV_SIZE) {
+		if (assoclen < ivsize)
+			return -EINVAL;
+		assoclen -= ivsize;
+	}
+
+	/* Block 0 gives the one time Poly1305 key, the payload starts at 1 */
+	memset(iv, 0, sizeof(u32));
+	memcpy(iv + sizeof(u32), ctx->salt, ctx->saltlen);
+	memcpy(iv + sizeof(u32) + ctx->saltlen, req->iv, ivsize);
+	crypto_chacha20_init(state, &ctx->chacha, iv);
+	chacha20_block(state, stream);
+	chachapoly_mac_init(&mac, (u8 *)stream);
+
+	chachapoly_mac_assoc(req, &mac, assoclen, neon);
+
+	if (enc)
+		err = skcipher_walk_aead_encrypt(&walk, req, false);
+	else
+		err = skcipher_walk_aead_decrypt(&walk, req, false);
+
+	while (walk.nbytes) {
+		unsigned int nbytes = walk.nbytes;
+
+		if (nbytes < walk.total)
+			nbytes = round_down(nbytes, walk.stride);
+
+		chachapoly_crypt_mac(state, &mac, walk.dst.virt.addr,
+				     walk.src.virt.addr, nbytes, enc, neon);
+		err = skcipher_walk_done(&walk, walk.nbytes - nbytes);
+	}
+	if (err)
+		goto out;
+
+	chachapoly_mac_pad(&mac);
+	lengths[0] = cpu_to_le64(assoclen);
+	lengths[1] = cpu_to_le64(cryptlen);
+	chachapoly_mac_update(&mac, (u8 *)lengths, sizeof(lengths), false);
+	chachapoly_mac_final(&mac, tag[0]);
+
+	if (enc) {
+		scatterwalk_map_and_copy(tag[0], req->dst,
+					 req->assoclen + cryptlen,
+					 POLY1305_DIGEST_SIZE, 1);
+	} else {
+		scatterwalk_map_and_copy(tag[1], req->src,
+					 req->assoclen + cryptlen,
+					 POLY1305_DIGEST_SIZE, 0);
+		if (crypto_memneq(tag[0], tag[1], POLY1305_DIGEST_SIZE))
+			err = -EBADMSG;
+	}
+
+out:
+	memzero_explicit(&mac, sizeof(mac));
+	memzero_explicit(state, sizeof(state));
+	memzero_explicit(stream, sizeof(stream));
+	return err;
+}
+
+static int chachapoly_neon_encrypt(struct aead_request *req)
+{
+	return chachapoly_neon_crypt(req, true);
+}
+
+static int chachapoly_neon_decrypt(struct aead_request *req)
+{
+	return chachapoly_neon_crypt(req, false);
+}
+
+static int chachapoly_neon_setkey(struct crypto_aead *tfm, const u8 *key,
+				  unsigned int keylen)
+{
+	struct chachapoly_neon_ctx *ctx = crypto_aead_ctx(tfm);
+	unsigned int saltlen = CHACHAPOLY_IV_SIZE - crypto_aead_ivsize(tfm);
+	int i;
+
+	if (keylen != CHACHA20_KEY_SIZE + saltlen) {
+		crypto_aead_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ctx->chacha.key); i++)
+		ctx->chacha.key[i] = get_unaligned_le32(key + i * sizeof(u32));
+	memcpy(ctx->salt, key + CHACHA20_KEY_SIZE, saltlen);
+	ctx->saltlen = saltlen;
+	return 0;
+}
+
+static int chachapoly_neon_setauthsize(struct crypto_aead *tfm,
+				       unsigned int authsize)
+{
+	if (authsize != POLY1305_DIGEST_SIZE)
+		return -EINVAL;
+	return 0;
+}
+
+static struct aead_alg chachapoly_algs[] = {
+	{
+		.base.cra_name		= "rfc7539(chacha20,poly1305)",
+		.base.cra_driver_name	= "rfc7539-chacha20-poly1305-neon",
+		.base.cra_priority	= 400,
+		.base.cra_blocksize	= 1,
+		.base.cra_ctxsize	= sizeof(struct chachapoly_neon_ctx),
+		.base.cra_module	= THIS_MODULE,
+
+		.ivsize			= CHACHAPOLY_IV_SIZE,
+		.chunksize		= CHACHA20_BLOCK_SIZE,
+		.maxauthsize		= POLY1305_DIGEST_SIZE,
+		.setkey			= chachapoly_neon_setkey,
+		.setauthsize		= chachapoly_neon_setauthsize,
+		.encrypt		= chachapoly_neon_encrypt,
+		.decrypt		= chachapoly_neon_decrypt,
+	}, {
+		.base.cra_name		= "rfc7539esp(chacha20,poly1305)",
+		.base.cra_driver_name	= "rfc7539esp-chacha20-poly1305-neon",
+		.base.cra_priority	= 400,
+		.base.cra_blocksize	= 1,
+		.base.cra_ctxsize	= sizeof(struct chachapoly_neon_ctx),
+		.base.cra_module	= THIS_MODULE,
+
+		.ivsize			= 8,
+		.chunksize		= CHACHA20_BLOCK_SIZE,
+		.maxauthsize		= POLY1305_DIGEST_SIZE,
+		.setkey			= chachapoly_neon_setkey,
+		.setauthsize		= chachapoly_neon_setauthsize,
+		.encrypt		= chachapoly_neon_encrypt,
+		.decrypt		= chachapoly_neon_decrypt,
+	},
+};
+
+static int __init poly1305_neon_mod_init(void)
+{
+	int err;
+
+	if (!(elf_hwcap & HWCAP_ASIMD))
+		return -ENODEV;
+
+	err = crypto_register_shash(&poly1305_alg);
+	if (err)
+		return err;
+
+	err = crypto_register_aeads(chachapoly_algs,
+				    ARRAY_SIZE(chachapoly_algs));
+	if (err)
+		crypto_unregister_shash(&poly1305_alg);
+	return err;
+}
+
+static void __exit poly1305_neon_mod_exit(void)
+{
+	crypto_unregister_aeads(chachapoly_algs, ARRAY_SIZE(chachapoly_algs));
+	crypto_unregister_shash(&poly1305_alg);
+}
+
+module_init(poly1305_neon_mod_init);
+module_exit(poly1305_neon_mod_exit);
+
+MODULE_DESCRIPTION("Poly1305 and ChaCha20-Poly1305, NEON accelerated");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS_CRYPTO("poly1305");
+MODULE_ALIAS_CRYPTO("poly1305-neon");
+MODULE_ALIAS_CRYPTO("rfc7539(chacha20,poly1305)");
+MODULE_ALIAS_CRYPTO("rfc7539esp(chacha20,poly1305)");
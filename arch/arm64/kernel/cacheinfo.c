@@ -19,7 +19,10 @@
 
 #include <linux/acpi.h>
 #include <linux/cacheinfo.h>
+#include <linux/cpumask.h>
+#include <linux/init.h>
 #include <linux/of.h>
+#include <linux/sizes.h>
 
 #define MAX_CACHE_LEVEL			7	/* Max 7 level supported */
 /* Ctypen, bits[3(n - 1) + 2 : 3(n - 1)], for n = 1 to 7 */
@@ -102,3 +105,35 @@ static int __populate_cache_leaves(unsigned int cpu)
 
 DEFINE_SMP_CALL_CACHE_FUNCTION(init_cache_level)
 DEFINE_SMP_CALL_CACHE_FUNCTION(populate_cache_leaves)
+
+/*
+ * memcpy() and the user copy routines switch to non-temporal stores for
+ * copies of at least this many bytes, see copy_template.S.  Copies that
+ * big would push most of the working set out of the last level cache.
+ */
+unsigned long copy_stream_threshold __ro_after_init = ULONG_MAX;
+
+#define COPY_STREAM_DEFAULT	SZ_1M
+
+static int __init copy_stream_threshold_init(void)
+{
+	unsigned int cpu, size = 0;
+
+	/* Half the smallest last level cache, big.LITTLE may differ */
+	for_each_online_cpu(cpu) {
+		struct cpu_cacheinfo *this_cpu_ci = get_cpu_cacheinfo(cpu);
+		struct cacheinfo *llc;
+
+		if (!this_cpu_ci->info_list || !this_cpu_ci->num_leaves)
+			continue;
+		llc = &this_cpu_ci->info_list[this_cpu_ci->num_leaves - 1];
+		if (llc->size && (!size || llc->size < size))
+			size = llc->size;
+	}
+
+	copy_stream_threshold = size ? size / 2 : COPY_STREAM_DEFAULT;
+	pr_info("Streaming copy threshold: %lu bytes\n",
+		copy_stream_threshold);
+	return 0;
+}
+late_initcall(copy_stream_threshold_init);
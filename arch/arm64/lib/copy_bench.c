@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Throughput of memcpy(), copy_to_user() and copy_from_user() over copy
+ * sizes from 8 bytes to 16 MiB and a few source/destination alignments,
+ * to check the small copy fast path and the streaming cutover set by
+ * copy_stream_threshold. The results are printed when the module loads.
+ */
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/mman.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/sizes.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#define COPY_BENCH_MIN		8
+#define COPY_BENCH_MAX		SZ_16M
+#define COPY_BENCH_SLACK	64	/* room for the misaligned offsets */
+
+/* each measurement copies about this much, in as many calls as it takes */
+#define COPY_BENCH_BYTES	SZ_64M
+
+static const struct {
+	unsigned int dst, src;
+} copy_bench_align[] = {
+	{ 0, 0 },
+	{ 0, 1 },
+	{ 1, 0 },
+	{ 3, 13 },
+	{ 8, 8 },
+};
+
+enum copy_bench_op { COPY_BENCH_MEMCPY, COPY_BENCH_TO_USER,
+		     COPY_BENCH_FROM_USER };
+
+static const char * const copy_bench_names[] = {
+	[COPY_BENCH_MEMCPY]	= "memcpy",
+	[COPY_BENCH_TO_USER]	= "copy_to_user",
+	[COPY_BENCH_FROM_USER]	= "copy_from_user",
+};
+
+/* Returns the throughput in MB/s, or a negative error */
+static long copy_bench_run(enum copy_bench_op op, void *kdst, void *ksrc,
+			   char __user *ubuf, size_t size)
+{
+	unsigned long i, loops = max_t(unsigned long,
+				       COPY_BENCH_BYTES / size, 1);
+	unsigned long left = 0;
+	u64 start, ns;
+
+	start = ktime_get_ns();
+	for (i = 0; i < loops && !left; i++) {
+		switch (op) {
+		case COPY_BENCH_MEMCPY:
+			memcpy(kdst, ksrc, size);
+			break;
+		case COPY_BENCH_TO_USER:
+			left = copy_to_user(ubuf, ksrc, size);
+			break;
+		case COPY_BENCH_FROM_USER:
+			left = copy_from_user(kdst, ubuf, size);
+			break;
+		}
+		barrier();
+	}
+	ns = ktime_get_ns() - start;
+
+	if (left)
+		return -EFAULT;
+	return div64_u64((u64)loops * size * NSEC_PER_USEC, max_t(u64, ns, 1));
+}
+
+static int copy_bench_init(void)
+{
+	size_t buf_size = COPY_BENCH_MAX + COPY_BENCH_SLACK;
+	unsigned long uaddr;
+	char *kdst, *ksrc;
+	enum copy_bench_op op;
+	unsigned int a;
+	size_t size;
+	long mbps;
+	int ret = 0;
+
+	kdst = vmalloc(buf_size);
+	ksrc = vmalloc(buf_size);
+	if (!kdst || !ksrc) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+	memset(ksrc, 0x5a, buf_size);
+	memset(kdst, 0, buf_size);
+
+	/* the user side is a mapping of the process loading the module */
+	uaddr = vm_mmap(NULL, 0, buf_size, PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, 0);
+	if (uaddr >= (unsigned long)(TASK_SIZE)) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+	/* fault the pages in, so that the first run does not pay for it */
+	if (copy_to_user((char __user *)uaddr, ksrc, buf_size)) {
+		ret = -EFAULT;
+		goto out_unmap;
+	}
+
+	pr_info("Copy throughput (MB/s):\n");
+	pr_info("%-15s %9s %4s %4s %8s\n", "function", "size", "dst", "src",
+		"MB/s");
+	for (op = 0; op < ARRAY_SIZE(copy_bench_names); op++) {
+		for (a = 0; a < ARRAY_SIZE(copy_bench_align); a++) {
+			unsigned int doff = copy_bench_align[a].dst;
+			unsigned int soff = copy_bench_align[a].src;
+			char __user *ubuf = (char __user *)uaddr;
+
+			/* the user buffer is the source or the destination */
+			ubuf += op == COPY_BENCH_TO_USER ? doff : soff;
+
+			for (size = COPY_BENCH_MIN; size <= COPY_BENCH_MAX;
+			     size <<= 1) {
+				mbps = copy_bench_run(op, kdst + doff,
+						      ksrc + soff, ubuf, size);
+				if (mbps < 0) {
+					pr_err("%s of %zu bytes failed\n",
+					       copy_bench_names[op], size);
+					ret = mbps;
+					goto out_unmap;
+				}
+				pr_info("%-15s %9zu %4u %4u %8ld\n",
+					copy_bench_names[op], size, doff, soff,
+					mbps);
+				cond_resched();
+			}
+		}
+	}
+
+out_unmap:
+	vm_munmap(uaddr, buf_size);
+out_free:
+	vfree(ksrc);
+	vfree(kdst);
+	return ret;
+}
+
+static void copy_bench_exit(void)
+{
+}
+
+module_init(copy_bench_init);
+module_exit(copy_bench_exit);
+
+MODULE_DESCRIPTION("memcpy and user copy throughput test");
+MODULE_LICENSE("GPL v2");
@@ -15,7 +15,9 @@
 #include <linux/module.h>
 #include <linux/export.h>
 #include <linux/kernel.h>
+#include <linux/list.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/seq_file.h>
 #include <linux/scatterlist.h>
 #include <keys/asymmetric-subtype.h>
@@ -59,6 +61,128 @@ static void public_key_destroy(void *payload0, void *payload3)
 	public_key_signature_free(payload3);
 }
 
+/*
+ * Signatures that have already been verified.  A signer certificate that
+ * comes with every PKCS#7 message gets its self-signature and the signature
+ * on it by the trusted key checked again for each message, so remember the
+ * last few successful verifications and skip the RSA operation when exactly
+ * the same check comes around again.  An entry keeps complete copies of the
+ * key, the signature and the digest, so a hit never accepts anything that
+ * would not have verified.
+ */
+#define PUBLIC_KEY_VERIFIED_SIZE	16
+
+struct public_key_verified {
+	struct list_head link;
+	u32 keylen;
+	u32 s_size;
+	u8 digest_size;
+	u8 data[];		/* key, s, digest, pkey_algo, hash_algo */
+};
+
+static LIST_HEAD(public_key_verified_list);
+static unsigned int public_key_verified_count;
+static DEFINE_SPINLOCK(public_key_verified_lock);
+
+static size_t public_key_verified_size(const struct public_key *pkey,
+				       const struct public_key_signature *sig)
+{
+	return pkey->keylen + sig->s_size + sig->digest_size +
+		strlen(sig->pkey_algo) + 1 + strlen(sig->hash_algo) + 1;
+}
+
+static void public_key_verified_fill(u8 *p, const struct public_key *pkey,
+				     const struct public_key_signature *sig)
+{
+	memcpy(p, pkey->key, pkey->keylen);
+	p += pkey->keylen;
+	memcpy(p, sig->s, sig->s_size);
+	p += sig->s_size;
+	memcpy(p, sig->digest, sig->digest_size);
+	p += sig->digest_size;
+	strcpy((char *)p, sig->pkey_algo);
+	p += strlen(sig->pkey_algo) + 1;
+	strcpy((char *)p, sig->hash_algo);
+}
+
+static bool public_key_verified_match(const struct public_key_verified *v,
+				      const struct public_key *pkey,
+				      const struct public_key_signature *sig)
+{
+	const u8 *p = v->data;
+
+	if (v->keylen != pkey->keylen || v->s_size != sig->s_size ||
+	    v->digest_size != sig->digest_size)
+		return false;
+	if (memcmp(p, pkey->key, pkey->keylen) != 0)
+		return false;
+	p += pkey->keylen;
+	if (memcmp(p, sig->s, sig->s_size) != 0)
+		return false;
+	p += sig->s_size;
+	if (memcmp(p, sig->digest, sig->digest_size) != 0)
+		return false;
+	p += sig->digest_size;
+	if (strcmp((const char *)p, sig->pkey_algo) != 0)
+		return false;
+	p += strlen(sig->pkey_algo) + 1;
+	return strcmp((const char *)p, sig->hash_algo) == 0;
+}
+
+static bool public_key_verified_lookup(const struct public_key *pkey,
+				       const struct public_key_signature *sig)
+{
+	struct public_key_verified *v;
+	bool found = false;
+
+	spin_lock(&public_key_verified_lock);
+	list_for_each_entry(v, &public_key_verified_list, link) {
+		if (public_key_verified_match(v, pkey, sig)) {
+			list_move(&v->link, &public_key_verified_list);
+			found = true;
+			break;
+		}
+	}
+	spin_unlock(&public_key_verified_lock);
+	return found;
+}
+
+static void public_key_verified_add(const struct public_key *pkey,
+				    const struct public_key_signature *sig)
+{
+	struct public_key_verified *v, *old = NULL;
+
+	v = kmalloc(sizeof(*v) + public_key_verified_size(pkey, sig),
+		    GFP_KERNEL);
+	if (!v)
+		return;
+	v->keylen = pkey->keylen;
+	v->s_size = sig->s_size;
+	v->digest_size = sig->digest_size;
+	public_key_verified_fill(v->data, pkey, sig);
+
+	spin_lock(&public_key_verified_lock);
+	list_add(&v->link, &public_key_verified_list);
+	if (++public_key_verified_count > PUBLIC_KEY_VERIFIED_SIZE) {
+		old = list_last_entry(&public_key_verified_list,
+				      struct public_key_verified, link);
+		list_del(&old->link);
+		public_key_verified_count--;
+	}
+	spin_unlock(&public_key_verified_lock);
+	kfree(old);
+}
+
+static void public_key_verified_clear(void)
+{
+	struct public_key_verified *v, *tmp;
+
+	list_for_each_entry_safe(v, tmp, &public_key_verified_list, link)
+		kfree(v);
+	INIT_LIST_HEAD(&public_key_verified_list);
+	public_key_verified_count = 0;
+}
+
 /*
  * Verify a signature using a public key.
  */
@@ -84,6 +208,9 @@ int public_key_verify_signature(const struct public_key *pkey,
 	if (!sig->digest)
 		return -ENOPKG;
 
+	if (sig->hash_algo && public_key_verified_lookup(pkey, sig))
+		return 0;
+
 	alg_name = sig->pkey_algo;
 	if (strcmp(sig->pkey_algo, "rsa") == 0) {
 		/* The data wangled by the RSA algorithm is typically padded
@@ -137,6 +264,8 @@ int public_key_verify_signature(const struct public_key *pkey,
 	if (req->dst_len != sig->digest_size ||
 	    memcmp(sig->digest, output, sig->digest_size) != 0)
 		ret = -EKEYREJECTED;
+	else if (sig->hash_algo)
+		public_key_verified_add(pkey, sig);
 
 out_free_output:
 	kfree(output);
@@ -170,3 +299,9 @@ struct asymmetric_key_subtype public_key_subtype = {
 	.verify_signature	= public_key_verify_signature_2,
 };
 EXPORT_SYMBOL_GPL(public_key_subtype);
+
+static void __exit public_key_exit(void)
+{
+	public_key_verified_clear();
+}
+module_exit(public_key_exit);
@@ -0,0 +1,213 @@
+/* Cache of parsed X.509 certificates
+ *
+ * The same signer certificate tends to turn up again and again, embedded in
+ * every PKCS#7 message it signs.  Parsing it costs an ASN.1 decode, a hash
+ * over the TBS data and, for a self-signed certificate, a signature check.
+ * Keep the last few certificates that parsed cleanly, keyed on their
+ * complete encoding, and hand out copies of those instead.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public Licence
+ * as published by the Free Software Foundation; either version
+ * 2 of the Licence, or (at your option) any later version.
+ */
+
+#define pr_fmt(fmt) "X.509: "fmt
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <keys/system_keyring.h>
+#include "x509_parser.h"
+
+#define X509_CERT_CACHE_SIZE	16
+
+struct x509_cert_cache_entry {
+	struct list_head	link;
+	struct x509_certificate	*cert;		/* Parsed from data[] */
+	size_t			datalen;
+	u8			data[];
+};
+
+static LIST_HEAD(x509_cert_cache);
+static unsigned int x509_cert_cache_count;
+static DEFINE_MUTEX(x509_cert_cache_lock);
+
+static struct asymmetric_key_id *x509_dup_key_id(const struct asymmetric_key_id *id,
+						 bool *failed)
+{
+	struct asymmetric_key_id *copy;
+
+	if (!id)
+		return NULL;
+	copy = kmemdup(id, sizeof(*id) + id->len, GFP_KERNEL);
+	if (!copy)
+		*failed = true;
+	return copy;
+}
+
+static const void *x509_rebase(const void *p, const void *from, const void *to)
+{
+	return p ? to + (p - from) : NULL;
+}
+
+/*
+ * Copy a certificate that was parsed from @from so that it refers to the
+ * identical encoding at @to.  The chain state that PKCS#7 verification
+ * keeps in the certificate is not copied.
+ */
+static struct x509_certificate *x509_cert_dup(const struct x509_certificate *src,
+					      const void *from, const void *to)
+{
+	struct x509_certificate *cert;
+	bool failed = false;
+	int i;
+
+	cert = kzalloc(sizeof(*cert), GFP_KERNEL);
+	if (!cert)
+		return NULL;
+
+	cert->pub = kmemdup(src->pub, sizeof(*src->pub), GFP_KERNEL);
+	if (!cert->pub)
+		goto error;
+	cert->pub->key = kmemdup(src->pub->key, src->pub->keylen, GFP_KERNEL);
+	if (!cert->pub->key)
+		goto error;
+
+	cert->sig = kmemdup(src->sig, sizeof(*src->sig), GFP_KERNEL);
+	if (!cert->sig)
+		goto error;
+	cert->sig->s = NULL;
+	cert->sig->digest = NULL;
+	for (i = 0; i < ARRAY_SIZE(cert->sig->auth_ids); i++)
+		cert->sig->auth_ids[i] =
+			x509_dup_key_id(src->sig->auth_ids[i], &failed);
+	cert->sig->s = kmemdup(src->sig->s, src->sig->s_size, GFP_KERNEL);
+	cert->sig->digest = kmemdup(src->sig->digest, src->sig->digest_size,
+				    GFP_KERNEL);
+	if (failed || !cert->sig->s || !cert->sig->digest)
+		goto error;
+
+	cert->issuer = kstrdup(src->issuer, GFP_KERNEL);
+	cert->subject = kstrdup(src->subject, GFP_KERNEL);
+	cert->id = x509_dup_key_id(src->id, &failed);
+	cert->skid = x509_dup_key_id(src->skid, &failed);
+	if (failed || !cert->issuer || !cert->subject)
+		goto error;
+
+	cert->valid_from	= src->valid_from;
+	cert->valid_to		= src->valid_to;
+	cert->tbs		= x509_rebase(src->tbs, from, to);
+	cert->tbs_size		= src->tbs_size;
+	cert->raw_sig		= x509_rebase(src->raw_sig, from, to);
+	cert->raw_sig_size	= src->raw_sig_size;
+	cert->raw_serial	= x509_rebase(src->raw_serial, from, to);
+	cert->raw_serial_size	= src->raw_serial_size;
+	cert->raw_issuer	= x509_rebase(src->raw_issuer, from, to);
+	cert->raw_issuer_size	= src->raw_issuer_size;
+	cert->raw_subject	= x509_rebase(src->raw_subject, from, to);
+	cert->raw_subject_size	= src->raw_subject_size;
+	cert->raw_skid		= x509_rebase(src->raw_skid, from, to);
+	cert->raw_skid_size	= src->raw_skid_size;
+	cert->self_signed	= src->self_signed;
+	return cert;
+
+error:
+	x509_free_certificate(cert);
+	return NULL;
+}
+
+static void x509_cert_cache_free(struct x509_cert_cache_entry *entry)
+{
+	list_del(&entry->link);
+	x509_cert_cache_count--;
+	x509_free_certificate(entry->cert);
+	kfree(entry);
+}
+
+/*
+ * Look for a certificate with exactly this encoding.  Returns a private copy
+ * that refers to @data, or NULL if the certificate has to be parsed.
+ */
+struct x509_certificate *x509_cert_cache_lookup(const void *data, size_t datalen)
+{
+	struct x509_cert_cache_entry *entry;
+	struct x509_certificate *cert = NULL;
+	const struct public_key_signature *sig;
+
+	mutex_lock(&x509_cert_cache_lock);
+	list_for_each_entry(entry, &x509_cert_cache, link) {
+		if (entry->datalen != datalen ||
+		    memcmp(entry->data, data, datalen) != 0)
+			continue;
+
+		/* The blacklist may have grown since the certificate was
+		 * parsed; let the parser flag it again.
+		 */
+		sig = entry->cert->sig;
+		if (is_hash_blacklisted(sig->digest, sig->digest_size,
+					"tbs") == -EKEYREJECTED) {
+			x509_cert_cache_free(entry);
+			break;
+		}
+
+		cert = x509_cert_dup(entry->cert, entry->data, data);
+		if (cert)
+			list_move(&entry->link, &x509_cert_cache);
+		break;
+	}
+	mutex_unlock(&x509_cert_cache_lock);
+	return cert;
+}
+
+/*
+ * Remember a freshly parsed certificate.  Only certificates that parsed
+ * fully are kept, as anything unsupported may become supported once the
+ * missing crypto module is loaded.
+ */
+void x509_cert_cache_add(const struct x509_certificate *cert,
+			 const void *data, size_t datalen)
+{
+	struct x509_cert_cache_entry *entry, *old;
+
+	if (cert->unsupported_key || cert->unsupported_sig || cert->blacklisted)
+		return;
+
+	entry = kmalloc(sizeof(*entry) + datalen, GFP_KERNEL);
+	if (!entry)
+		return;
+	memcpy(entry->data, data, datalen);
+	entry->datalen = datalen;
+	entry->cert = x509_cert_dup(cert, data, entry->data);
+	if (!entry->cert) {
+		kfree(entry);
+		return;
+	}
+
+	mutex_lock(&x509_cert_cache_lock);
+	list_for_each_entry(old, &x509_cert_cache, link) {
+		if (old->datalen == datalen &&
+		    memcmp(old->data, data, datalen) == 0) {
+			/* Raced with another parse of the same certificate */
+			x509_cert_cache_free(old);
+			break;
+		}
+	}
+	list_add(&entry->link, &x509_cert_cache);
+	if (++x509_cert_cache_count > X509_CERT_CACHE_SIZE)
+		x509_cert_cache_free(list_last_entry(&x509_cert_cache,
+						     struct x509_cert_cache_entry,
+						     link));
+	mutex_unlock(&x509_cert_cache_lock);
+}
+
+void x509_cert_cache_clear(void)
+{
+	struct x509_cert_cache_entry *entry, *tmp;
+
+	mutex_lock(&x509_cert_cache_lock);
+	list_for_each_entry_safe(entry, tmp, &x509_cert_cache, link)
+		x509_cert_cache_free(entry);
+	mutex_unlock(&x509_cert_cache_lock);
+}
@@ -61,7 +61,7 @@ EXPORT_SYMBOL_GPL(x509_free_certificate);
 /*
  * Parse an X.509 certificate
  */
-struct x509_certificate *x509_cert_parse(const void *data, size_t datalen)
+static struct x509_certificate *__x509_cert_parse(const void *data, size_t datalen)
 {
 	struct x509_certificate *cert;
 	struct x509_parse_context *ctx;
@@ -140,6 +140,20 @@ struct x509_certificate *x509_cert_parse(const void *data, size_t datalen)
 error_no_cert:
 	return ERR_PTR(ret);
 }
+
+struct x509_certificate *x509_cert_parse(const void *data, size_t datalen)
+{
+	struct x509_certificate *cert;
+
+	cert = x509_cert_cache_lookup(data, datalen);
+	if (cert)
+		return cert;
+
+	cert = __x509_cert_parse(data, datalen);
+	if (!IS_ERR(cert))
+		x509_cert_cache_add(cert, data, datalen);
+	return cert;
+}
 EXPORT_SYMBOL_GPL(x509_cert_parse);
 
 /*
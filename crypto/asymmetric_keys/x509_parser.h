@@ -54,6 +54,15 @@ extern int x509_decode_time(time64_t *_t,  size_t hdrlen,
 			    unsigned char tag,
 			    const unsigned char *value, size_t vlen);
 
+/*
+ * x509_cache.c
+ */
+extern struct x509_certificate *x509_cert_cache_lookup(const void *data,
+						       size_t datalen);
+extern void x509_cert_cache_add(const struct x509_certificate *cert,
+				const void *data, size_t datalen);
+extern void x509_cert_cache_clear(void);
+
 /*
  * x509_public_key.c
  */
@@ -265,6 +265,7 @@ static int __init x509_key_init(void)
 static void __exit x509_key_exit(void)
 {
 	unregister_asymmetric_key_parser(&x509_key_parser);
+	x509_cert_cache_clear();
 }
 
 module_init(x509_key_init);
@@ -15,8 +15,10 @@
 #include <linux/time.h>
 #include <linux/ktime.h>
 #include <linux/hrtimer.h>
+#include <linux/interrupt.h>
 #include <linux/tick.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
 #include <linux/sched/loadavg.h>
 #include <linux/sched/stat.h>
 #include <linux/math64.h>
@@ -274,6 +276,29 @@ static unsigned int get_typical_interval(struct menu_device *data)
 	goto again;
 }
 
+#ifdef CONFIG_CPU_IDLE_GOV_MENU_IRQ_TIMINGS
+/*
+ * Return the time in us until the next interrupt predicted by the irq
+ * timings, or UINT_MAX if there is no reliable prediction. A periodic
+ * device interrupt is as good as a timer to bound the idle duration.
+ */
+static unsigned int menu_next_irq_us(void)
+{
+	u64 now = local_clock();
+	u64 next_evt = irq_timings_next_event(now);
+
+	if (next_evt == U64_MAX)
+		return UINT_MAX;
+
+	return min_t(u64, div_u64(next_evt - now, NSEC_PER_USEC), UINT_MAX);
+}
+#else
+static inline unsigned int menu_next_irq_us(void)
+{
+	return UINT_MAX;
+}
+#endif
+
 /**
  * menu_select - selects the next idle state to enter
  * @drv: cpuidle driver containing state data
@@ -290,6 +315,7 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	int idx;
 	unsigned int interactivity_req;
 	unsigned int expected_interval;
+	unsigned int next_irq_us;
 	unsigned long nr_iowaiters, cpu_load;
 	ktime_t delta_next;
 
@@ -322,6 +348,13 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	expected_interval = get_typical_interval(data);
 	expected_interval = min(expected_interval, data->next_timer_us);
 
+	/*
+	 * A predictable device interrupt wakes us up as surely as the
+	 * next timer does.
+	 */
+	next_irq_us = menu_next_irq_us();
+	expected_interval = min(expected_interval, next_irq_us);
+
 	first_idx = 0;
 	if (drv->states[0].flags & CPUIDLE_FLAG_POLLING) {
 		struct cpuidle_state *s = &drv->states[1];
@@ -354,6 +387,12 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 		 */
 		if (data->predicted_us < TICK_USEC)
 			data->predicted_us = ktime_to_us(delta_next);
+
+		/*
+		 * Unless a periodic interrupt is known to be coming
+		 * soon, which makes the misprediction unlikely.
+		 */
+		data->predicted_us = min(data->predicted_us, next_irq_us);
 	} else {
 		/*
 		 * Use the performance multiplier and the user-configurable
@@ -593,6 +632,9 @@ static struct cpuidle_governor menu_governor = {
  */
 static int __init init_menu(void)
 {
+	if (IS_ENABLED(CONFIG_CPU_IDLE_GOV_MENU_IRQ_TIMINGS))
+		irq_timings_enable();
+
 	return cpuidle_register_governor(&menu_governor);
 }
 
@@ -38,11 +38,18 @@ struct xlnx_ptp_timer {
 	int                    countpulse;
 };
 
-static void xlnx_tod_read(struct xlnx_ptp_timer *timer, struct timespec64 *ts)
+/* Reading the nanoseconds latches the seconds, so the nanoseconds read is
+ * the instant the time is sampled at and the only one the system clock
+ * readings need to bracket.
+ */
+static void xlnx_tod_read(struct xlnx_ptp_timer *timer, struct timespec64 *ts,
+			  struct ptp_system_timestamp *sts)
 {
 	u32 sec, nsec;
 
+	ptp_read_system_prets(sts);
 	nsec = in_be32(timer->baseaddr + XTIMER1588_CURRENT_RTC_NS);
+	ptp_read_system_postts(sts);
 	sec = in_be32(timer->baseaddr + XTIMER1588_CURRENT_RTC_SEC_L);
 
 	ts->tv_sec = sec;
@@ -119,14 +126,15 @@ static int xlnx_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
 	return 0;
 }
 
-static int xlnx_ptp_gettime(struct ptp_clock_info *ptp, struct timespec64 *ts)
+static int xlnx_ptp_gettimex(struct ptp_clock_info *ptp, struct timespec64 *ts,
+			     struct ptp_system_timestamp *sts)
 {
 	unsigned long flags;
 	struct xlnx_ptp_timer *timer = container_of(ptp, struct xlnx_ptp_timer,
 						    ptp_clock_info);
 	spin_lock_irqsave(&timer->reg_lock, flags);
 
-	xlnx_tod_read(timer, ts);
+	xlnx_tod_read(timer, ts, sts);
 
 	spin_unlock_irqrestore(&timer->reg_lock, flags);
 	return 0;
@@ -160,7 +168,7 @@ static int xlnx_ptp_settime(struct ptp_clock_info *ptp,
 	xlnx_rtc_offset_write(timer, &offset);
 
 	/* Get the current timer value */
-	xlnx_tod_read(timer, &tod);
+	xlnx_tod_read(timer, &tod, NULL);
 
 	/* Subtract the current reported time from our desired time */
 	delta = timespec64_sub(*ts, tod);
@@ -202,7 +210,7 @@ static struct ptp_clock_info xlnx_ptp_clock_info = {
 	.pps      = 1,
 	.adjfreq  = xlnx_ptp_adjfreq,
 	.adjtime  = xlnx_ptp_adjtime,
-	.gettime64  = xlnx_ptp_gettime,
+	.gettimex64 = xlnx_ptp_gettimex,
 	.settime64 = xlnx_ptp_settime,
 	.enable   = xlnx_ptp_enable,
 };
@@ -727,7 +727,9 @@ static inline void cgroup_path_from_kernfs_id(const union kernfs_node_id *id,
 void cgroup_rstat_updated(struct cgroup *cgrp, int cpu);
 void cgroup_rstat_flush(struct cgroup *cgrp);
 void cgroup_rstat_flush_irqsafe(struct cgroup *cgrp);
+void cgroup_rstat_flush_lazy(struct cgroup *cgrp);
 void cgroup_rstat_flush_hold(struct cgroup *cgrp);
+void cgroup_rstat_flush_hold_lazy(struct cgroup *cgrp);
 void cgroup_rstat_flush_release(void);
 
 /*
@@ -708,6 +708,14 @@ static inline void init_irq_proc(void)
 void irq_timings_enable(void);
 void irq_timings_disable(void);
 u64 irq_timings_next_event(u64 now);
+int irq_timings_predict(unsigned int irq, u64 now, u64 *next_evt);
+#else
+static inline void irq_timings_enable(void) { }
+static inline void irq_timings_disable(void) { }
+static inline int irq_timings_predict(unsigned int irq, u64 now, u64 *next_evt)
+{
+	return -ENOENT;
+}
 #endif
 
 struct seq_file;
@@ -28,6 +28,9 @@
  * @iprim:	prim-th root of 1, index form
  * @gfpoly:	The primitive generator polynominal
  * @gffunc:	Function to generate the field, if non-canonical representation
+ * @enc_tab:	Encoder feedback rows, [256][nroots] (8 bit symbols only)
+ * @syn_tab:	Root multiplication tables, [nroots][256] (8 bit symbols only)
+ * @syn_nib:	Split nibble tables for root^16, [nroots][32] (8 bit symbols only)
  * @users:	Users of this structure
  * @list:	List entry for the rs codec list
 */
@@ -43,6 +46,9 @@ struct rs_codec {
 	int		iprim;
 	int		gfpoly;
 	int		(*gffunc)(int);
+	uint8_t		*enc_tab;
+	uint8_t		*syn_tab;
+	uint8_t		*syn_nib;
 	int		users;
 	struct list_head list;
 };
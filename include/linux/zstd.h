@@ -650,6 +650,90 @@ size_t ZSTD_CStreamOutSize(void);
 
 
 
+/*-*****************************************************************************
+ * Parallel compression - HowTo
+ *
+ * A ZSTD_MTCtx object cuts its input into jobs of jobSize bytes, and
+ * compresses each job into an independent frame on up to nbWorkers CPUs.
+ * Use ZSTD_initMTCtx() to initialize a ZSTD_MTCtx object.
+ * ZSTD_MTCtx objects can be re-used multiple times, but not concurrently.
+ *
+ * The frames are written to dst in input order, so the output of
+ * ZSTD_compressMT() is a regular zstd stream which ZSTD_decompressDCtx() and
+ * ZSTD_decompressStream() decompress as a whole. Every job can also be
+ * located with ZSTD_findFrameCompressedSize() and decompressed on its own.
+ * Successive calls append more frames to the stream, so input larger than
+ * the caller can buffer at once is compressed piecewise.
+ *
+ * Frames don't reference each other, so jobs much smaller than the window
+ * size cost compression ratio. ZSTD_compressMT() sleeps and must be called
+ * from process context.
+ ******************************************************************************/
+
+/**
+ * ZSTD_MTCtxWorkspaceBound() - memory needed to initialize a ZSTD_MTCtx
+ * @cParams:   The compression parameters to be used for compression.
+ * @jobSize:   The amount of input compressed into each frame.
+ * @nbWorkers: The maximum number of jobs compressed concurrently.
+ *
+ * Each worker needs a ZSTD_CCtx workspace and a buffer holding one
+ * compressed job.
+ *
+ * Return:     A lower bound on the size of the workspace that is passed to
+ *             ZSTD_initMTCtx().
+ */
+size_t ZSTD_MTCtxWorkspaceBound(ZSTD_compressionParameters cParams,
+	size_t jobSize, unsigned int nbWorkers);
+
+/**
+ * ZSTD_compressMTBound() - maximum compressed size in worst case scenario
+ * @srcSize: The size of the data to compress.
+ * @jobSize: The jobSize the ZSTD_MTCtx was initialized with.
+ *
+ * Return:   The maximum compressed size of ZSTD_compressMT() in the worst case
+ *           scenario.
+ */
+size_t ZSTD_compressMTBound(size_t srcSize, size_t jobSize);
+
+/**
+ * struct ZSTD_MTCtx - the zstd parallel compression context
+ */
+typedef struct ZSTD_MTCtx_s ZSTD_MTCtx;
+/**
+ * ZSTD_initMTCtx() - initialize a zstd parallel compression context
+ * @params:        The zstd compression parameters, used for every frame.
+ * @jobSize:       The amount of input compressed into each frame.
+ * @nbWorkers:     The maximum number of jobs compressed concurrently, usually
+ *                 the number of CPUs the caller is willing to occupy.
+ * @workspace:     The workspace to emplace the context into. It must outlive
+ *                 the returned context.
+ * @workspaceSize: The size of workspace. Use ZSTD_MTCtxWorkspaceBound() to
+ *                 determine how large the workspace must be.
+ *
+ * Return:         A parallel compression context emplaced into workspace or
+ *                 NULL on error.
+ */
+ZSTD_MTCtx *ZSTD_initMTCtx(ZSTD_parameters params, size_t jobSize,
+	unsigned int nbWorkers, void *workspace, size_t workspaceSize);
+
+/**
+ * ZSTD_compressMT() - compress src into dst using several CPUs
+ * @mtctx:       The parallel compression context.
+ * @dst:         The buffer to compress src into.
+ * @dstCapacity: The size of the destination buffer. May be any size, but
+ *               ZSTD_compressMTBound(srcSize, jobSize) is guaranteed to be
+ *               large enough.
+ * @src:         The data to compress.
+ * @srcSize:     The size of the data to compress.
+ *
+ * Return:       The compressed size or an error, which can be checked using
+ *               ZSTD_isError().
+ */
+size_t ZSTD_compressMT(ZSTD_MTCtx *mtctx, void *dst, size_t dstCapacity,
+	const void *src, size_t srcSize);
+
+
+
 /*-*****************************************************************************
  * Streaming decompression - HowTo
  *
@@ -519,9 +519,12 @@ struct ip_vs_conn {
 	__u16			daf;		/* Address family of the dest */
 	struct netns_ipvs	*ipvs;
 
-	/* counter and timer */
+	/* counter and expiry */
 	refcount_t		refcnt;		/* reference count */
-	struct timer_list	timer;		/* Expiration timer */
+	struct hlist_node	exp_node;	/* slot on an expiry wheel */
+	unsigned long		expires;	/* expiry time in jiffies */
+	unsigned long		exp_due;	/* when its slot gets scanned */
+	int			exp_cpu;	/* wheel it is queued on, or -1 */
 	volatile unsigned long	timeout;	/* timeout */
 
 	/* Flags and state transition */
@@ -1217,6 +1220,12 @@ static inline void __ip_vs_conn_put(struct ip_vs_conn *cp)
 	smp_mb__before_atomic();
 	refcount_dec(&cp->refcnt);
 }
+
+/* Is the conn queued for expiry, what used to be a pending timer */
+static inline bool ip_vs_conn_expiry_pending(const struct ip_vs_conn *cp)
+{
+	return READ_ONCE(cp->exp_cpu) >= 0;
+}
 void ip_vs_conn_put(struct ip_vs_conn *cp);
 void ip_vs_conn_fill_cport(struct ip_vs_conn *cp, __be16 cport);
 
@@ -41,6 +41,7 @@
 #include <linux/tcp.h>
 #include <net/tcp.h>
 #include <net/strparser.h>
+#include <crypto/aead.h>
 
 #include <uapi/linux/tls.h>
 
@@ -93,11 +94,19 @@ enum {
 	TLS_NUM_CONFIG,
 };
 
-struct tls_sw_context_tx {
-	struct crypto_aead *aead_send;
-	struct crypto_wait async_wait;
+/* TLS records are maintained in 'struct tls_rec'. It stores the memory pages
+ * allocated or mapped for each TLS record. After encryption, the records are
+ * stored in a linked list.
+ */
+struct tls_rec {
+	struct list_head list;
+	int tx_ready;
+	int tx_flags;
 
-	char aad_space[TLS_AAD_SPACE_SIZE];
+	/* AAD | sg_plaintext_data | sg_tag */
+	struct scatterlist sg_aead_in[2];
+	/* AAD | sg_encrypted_data (data contain overhead for hdr&iv&tag) */
+	struct scatterlist sg_aead_out[2];
 
 	unsigned int sg_plaintext_size;
 	int sg_plaintext_num_elem;
@@ -107,15 +116,37 @@ struct tls_sw_context_tx {
 	int sg_encrypted_num_elem;
 	struct scatterlist sg_encrypted_data[MAX_SKB_FRAGS];
 
-	/* AAD | sg_plaintext_data | sg_tag */
-	struct scatterlist sg_aead_in[2];
-	/* AAD | sg_encrypted_data (data contain overhead for hdr&iv&tag) */
-	struct scatterlist sg_aead_out[2];
+	char aad_space[TLS_AAD_SPACE_SIZE];
+	u8 iv_data[TLS_CIPHER_AES_GCM_128_IV_SIZE +
+		   TLS_CIPHER_AES_GCM_128_SALT_SIZE];
+	struct aead_request aead_req;
+	/* Keep aead_req at the end, its context follows it */
+};
+
+struct tx_work {
+	struct work_struct work;
+	struct sock *sk;
+};
+
+/* Bits in tls_sw_context_tx.tx_bitmask */
+#define BIT_TX_SCHEDULED	0
+
+struct tls_sw_context_tx {
+	struct crypto_aead *aead_send;
+	struct crypto_wait async_wait;
+	struct tx_work tx_work;
+	struct tls_rec *open_rec;
+	struct list_head tx_list;
+	/* Encryptions in flight, plus one while nobody waits for them */
+	atomic_t encrypt_pending;
+	unsigned long tx_bitmask;
 };
 
 struct tls_sw_context_rx {
 	struct crypto_aead *aead_recv;
 	struct crypto_wait async_wait;
+	/* Decryptions in flight, plus one while nobody waits for them */
+	atomic_t decrypt_pending;
 
 	struct strparser strp;
 	void (*saved_data_ready)(struct sock *sk);
@@ -277,8 +308,11 @@ void tls_sk_destruct(struct sock *sk, struct tls_context *ctx);
 int tls_push_sg(struct sock *sk, struct tls_context *ctx,
 		struct scatterlist *sg, u16 first_offset,
 		int flags);
+int tls_push_partial_record(struct sock *sk, struct tls_context *ctx,
+			    int flags);
 int tls_push_pending_closed_record(struct sock *sk, struct tls_context *ctx,
 				   int flags, long *timeo);
+int tls_tx_records(struct sock *sk, int flags);
 
 static inline bool tls_is_pending_closed_record(struct tls_context *ctx)
 {
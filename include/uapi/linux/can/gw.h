@@ -80,6 +80,8 @@ enum {
 	CGW_DELETED,	/* number of deleted CAN frames (see max_hops param) */
 	CGW_LIM_HOPS,	/* limit the number of hops of this specific rule */
 	CGW_MOD_UID,	/* user defined identifier for modification updates */
+	CGW_BPF_FD,	/* fd of a BPF program run on each CAN frame */
+	CGW_BPF_ID,	/* id of the attached BPF program (dump only) */
 	__CGW_MAX
 };
 
@@ -168,6 +170,25 @@ enum {
  * Optional non-zero user defined routing job identifier to alter existing
  * modification settings at runtime.
  *
+ * CGW_BPF_FD (length 4 bytes):
+ * File descriptor of a BPF_PROG_TYPE_SCHED_CLS program that is run on the
+ * CAN frame after the CGW_MOD_(AND|OR|XOR|SET) modifications and before the
+ * checksum updates. The program sees the struct can_frame at the start of
+ * the packet data and may rewrite it (e.g. with bpf_skb_store_bytes()) but
+ * not change its length. Programs calling helpers other than
+ * bpf_skb_load_bytes(), bpf_skb_store_bytes(), bpf_skb_pull_data() and
+ * bpf_redirect() (without BPF_F_INGRESS) are rejected. The attribute is
+ * refused with EOPNOTSUPP unless can-gw is built with CONFIG_CAN_GW_BPF.
+ * Return values:
+ *
+ * TC_ACT_OK,
+ * TC_ACT_UNSPEC   send the frame to the destination interface
+ * TC_ACT_REDIRECT send the frame to the CAN interface given to bpf_redirect()
+ * others          drop the frame
+ *
+ * CGW_BPF_ID (length 4 bytes):
+ * Id of the BPF program attached with CGW_BPF_FD, reported in job dumps.
+ *
  * CGW_CS_XOR (length 4 bytes):
  * Set a simple XOR checksum starting with an initial value into
  * data[result-idx] using data[start-idx] .. data[end-idx]
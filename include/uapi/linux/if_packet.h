@@ -57,6 +57,7 @@ struct sockaddr_ll {
 #define PACKET_QDISC_BYPASS		20
 #define PACKET_ROLLOVER_STATS		21
 #define PACKET_FANOUT_DATA		22
+#define PACKET_RING_CPU			23
 
 #define PACKET_FANOUT_HASH		0
 #define PACKET_FANOUT_LB		1
@@ -66,6 +67,7 @@ struct sockaddr_ll {
 #define PACKET_FANOUT_QM		5
 #define PACKET_FANOUT_CBPF		6
 #define PACKET_FANOUT_EBPF		7
+#define PACKET_FANOUT_CPU_RING		8
 #define PACKET_FANOUT_FLAG_ROLLOVER	0x1000
 #define PACKET_FANOUT_FLAG_UNIQUEID	0x2000
 #define PACKET_FANOUT_FLAG_DEFRAG	0x8000
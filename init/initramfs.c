@@ -10,6 +10,12 @@
 #include <linux/syscalls.h>
 #include <linux/utime.h>
 #include <linux/file.h>
+#include <linux/async.h>
+#include <linux/completion.h>
+#include <linux/kthread.h>
+#include <linux/mm.h>
+#include <linux/sizes.h>
+#include <linux/wait.h>
 
 static ssize_t __init xwrite(int fd, const char *p, size_t count)
 {
@@ -434,6 +440,115 @@ static long __init flush_buffer(void *bufv, unsigned long len)
 	return origLen;
 }
 
+/*
+ * Decompression and cpio extraction are both CPU bound.  Run extraction
+ * on a thread of its own, fed with copies of the decompressor's output,
+ * so the two overlap.  At most PIPE_BYTES are queued at a time.
+ */
+#define PIPE_BYTES	SZ_1M
+
+struct pipe_chunk {
+	struct list_head list;
+	unsigned long len;
+	char data[];
+};
+
+static __initdata LIST_HEAD(pipe_list);
+static __initdata DEFINE_SPINLOCK(pipe_lock);
+static __initdata DECLARE_WAIT_QUEUE_HEAD(pipe_data_wait);
+static __initdata DECLARE_WAIT_QUEUE_HEAD(pipe_space_wait);
+static __initdata DECLARE_COMPLETION(pipe_finished);
+static unsigned long pipe_queued __initdata;
+static bool pipe_closed __initdata;
+
+static struct pipe_chunk * __init pipe_pop(void)
+{
+	struct pipe_chunk *chunk;
+
+	spin_lock(&pipe_lock);
+	chunk = list_first_entry_or_null(&pipe_list, struct pipe_chunk, list);
+	if (chunk)
+		list_del(&chunk->list);
+	spin_unlock(&pipe_lock);
+	return chunk;
+}
+
+static bool __init pipe_has_space(void)
+{
+	bool ret;
+
+	spin_lock(&pipe_lock);
+	ret = pipe_queued < PIPE_BYTES || list_empty(&pipe_list);
+	spin_unlock(&pipe_lock);
+	return ret;
+}
+
+static int __init pipe_extract(void *unused)
+{
+	struct pipe_chunk *chunk;
+
+	for (;;) {
+		wait_event(pipe_data_wait,
+			   (chunk = pipe_pop()) || READ_ONCE(pipe_closed));
+		if (!chunk && !(chunk = pipe_pop()))
+			break;
+
+		flush_buffer(chunk->data, chunk->len);
+
+		spin_lock(&pipe_lock);
+		pipe_queued -= chunk->len;
+		spin_unlock(&pipe_lock);
+		wake_up(&pipe_space_wait);
+		kvfree(chunk);
+	}
+	complete(&pipe_finished);
+	return 0;
+}
+
+static long __init pipe_flush(void *bufv, unsigned long len)
+{
+	struct pipe_chunk *chunk;
+
+	if (READ_ONCE(message))
+		return -1;
+
+	chunk = kvmalloc(sizeof(*chunk) + len, GFP_KERNEL);
+	if (!chunk) {
+		error("can't allocate buffers");
+		return -1;
+	}
+	memcpy(chunk->data, bufv, len);
+	chunk->len = len;
+
+	wait_event(pipe_space_wait, pipe_has_space());
+	spin_lock(&pipe_lock);
+	list_add_tail(&chunk->list, &pipe_list);
+	pipe_queued += len;
+	spin_unlock(&pipe_lock);
+	wake_up(&pipe_data_wait);
+	return len;
+}
+
+static bool __init pipe_open(void)
+{
+	struct task_struct *tsk;
+
+	if (num_online_cpus() < 2)
+		return false;
+
+	pipe_closed = false;
+	reinit_completion(&pipe_finished);
+	tsk = kthread_run(pipe_extract, NULL, "initramfs");
+	return !IS_ERR(tsk);
+}
+
+static void __init pipe_close(void)
+{
+	WRITE_ONCE(pipe_closed, true);
+	wake_up(&pipe_data_wait);
+	wait_for_completion(&pipe_finished);
+}
+
 static unsigned long my_inptr; /* index of next byte to be processed in inbuf */
 
 #include <linux/decompress/generic.h>
@@ -474,8 +589,13 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 		decompress = decompress_method(buf, len, &compress_name);
 		pr_debug("Detected %s compressed data\n", compress_name);
 		if (decompress) {
-			int res = decompress(buf, len, NULL, flush_buffer, NULL,
+			bool piped = pipe_open();
+			int res = decompress(buf, len, NULL,
+				   piped ? pipe_flush : flush_buffer, NULL,
 				   &my_inptr, error);
+
+			if (piped)
+				pipe_close();
 			if (res)
 				error("decompressor failed");
 		} else if (compress_name) {
@@ -597,7 +717,15 @@ static void __init clean_rootfs(void)
 }
 #endif
 
-static int __init populate_rootfs(void)
+static bool __initdata initramfs_async = true;
+static int __init initramfs_async_setup(char *str)
+{
+	strtobool(str, &initramfs_async);
+	return 1;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
+static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 {
 	/* Load the built in initramfs */
 	char *err = unpack_to_rootfs(__initramfs_start, __initramfs_size);
@@ -649,7 +777,38 @@ static int __init populate_rootfs(void)
 	 * us a chance to load before device_initcalls.
 	 */
 	load_default_modules();
+}
+
+static ASYNC_DOMAIN_EXCLUSIVE(initramfs_domain);
+static async_cookie_t initramfs_cookie;
 
+/*
+ * Unpacking runs asynchronously, in parallel with the device initcalls.
+ * Anything that wants files from the initramfs (firmware, /init, usermode
+ * helpers) has to wait for it here first.
+ */
+void wait_for_initramfs(void)
+{
+	if (!initramfs_cookie) {
+		/*
+		 * Something before rootfs_initcall wants to access the
+		 * filesystem.  Probably a bug.  Make a note, avoid
+		 * deadlocking the machine, and let the caller's access
+		 * fail as it used to.
+		 */
+		pr_warn_once("wait_for_initramfs() called before rootfs_initcalls\n");
+		return;
+	}
+	async_synchronize_cookie_domain(initramfs_cookie + 1, &initramfs_domain);
+}
+EXPORT_SYMBOL_GPL(wait_for_initramfs);
+
+static int __init populate_rootfs(void)
+{
+	initramfs_cookie = async_schedule_domain(do_populate_rootfs, NULL,
+						 &initramfs_domain);
+	if (!initramfs_async)
+		wait_for_initramfs();
 	return 0;
 }
 rootfs_initcall(populate_rootfs);
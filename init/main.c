@@ -1143,6 +1143,8 @@ static noinline void __init kernel_init_freeable(void)
 
 	do_basic_setup();
 
+	wait_for_initramfs();
+
 	/* Open the /dev/console on the rootfs, this should never fail */
 	if (ksys_open((const char __user *) "/dev/console", O_RDWR, 0) < 0)
 		pr_err("Warning: unable to open an initial console.\n");
@@ -38,6 +38,7 @@
 #include <linux/mm.h>
 #include <linux/memory.h>
 #include <linux/export.h>
+#include <linux/moduleparam.h>
 #include <linux/mount.h>
 #include <linux/namei.h>
 #include <linux/pagemap.h>
@@ -298,6 +299,18 @@ static struct workqueue_struct *cpuset_migrate_mm_wq;
 static void cpuset_hotplug_workfn(struct work_struct *work);
 static DECLARE_WORK(cpuset_hotplug_work, cpuset_hotplug_workfn);
 
+/*
+ * The sched domain rebuilds requested by cpuset writes can be deferred
+ * by up to rebuild_delay_ms, so that a series of writes reconfiguring
+ * the partitions results in a single rebuild.  Zero rebuilds the sched
+ * domains synchronously from each write.
+ */
+static unsigned int rebuild_delay_ms;
+module_param(rebuild_delay_ms, uint, 0644);
+
+static void cpuset_rebuild_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(cpuset_rebuild_work, cpuset_rebuild_workfn);
+
 static DECLARE_WAIT_QUEUE_HEAD(cpuset_attach_wq);
 
 /*
@@ -862,6 +875,49 @@ void rebuild_sched_domains(void)
 	mutex_unlock(&cpuset_mutex);
 }
 
+static void cpuset_rebuild_workfn(struct work_struct *work)
+{
+	rebuild_sched_domains();
+}
+
+/*
+ * With load balancing enabled on the top cpuset, there is a single
+ * sched domain spanning all the housekeeping CPUs regardless of the
+ * descendants, which only contribute their sched_relax_domain_level.
+ * Returns false if the sched domains don't depend on the cpus and the
+ * load balancing flag of @cs.
+ */
+static bool sched_domains_depend_on(struct cpuset *cs)
+{
+	return cs == &top_cpuset || !is_sched_load_balance(&top_cpuset) ||
+	       cs->relax_domain_level != -1;
+}
+
+/*
+ * Rebuild the sched domains, possibly deferred to coalesce the rebuild
+ * with the ones requested by the following cpuset writes.  The delay is
+ * not extended by the requests made while a rebuild is pending, so the
+ * sched domains lag the cpuset configuration by at most
+ * rebuild_delay_ms.  The tasks cpumasks are always updated
+ * synchronously.
+ *
+ * Call with cpuset_mutex held.
+ */
+static void request_rebuild_sched_domains(void)
+{
+	unsigned int delay = READ_ONCE(rebuild_delay_ms);
+
+	lockdep_assert_held(&cpuset_mutex);
+
+	if (!delay) {
+		rebuild_sched_domains_locked();
+		return;
+	}
+
+	queue_delayed_work(system_unbound_wq, &cpuset_rebuild_work,
+			   msecs_to_jiffies(delay));
+}
+
 /**
  * update_tasks_cpumask - Update the cpumasks of tasks in the cpuset.
  * @cs: the cpuset in which each task's cpus_allowed mask needs to be changed
@@ -936,7 +992,7 @@ static void update_cpumasks_hier(struct cpuset *cs, struct cpumask *new_cpus)
 		 * we need to rebuild sched domains.
 		 */
 		if (!cpumask_empty(cp->cpus_allowed) &&
-		    is_sched_load_balance(cp))
+		    is_sched_load_balance(cp) && sched_domains_depend_on(cp))
 			need_rebuild_sched_domains = true;
 
 		rcu_read_lock();
@@ -945,7 +1001,7 @@ static void update_cpumasks_hier(struct cpuset *cs, struct cpumask *new_cpus)
 	rcu_read_unlock();
 
 	if (need_rebuild_sched_domains)
-		rebuild_sched_domains_locked();
+		request_rebuild_sched_domains();
 }
 
 /**
@@ -1277,7 +1333,7 @@ static int update_relax_domain_level(struct cpuset *cs, s64 val)
 		cs->relax_domain_level = val;
 		if (!cpumask_empty(cs->cpus_allowed) &&
 		    is_sched_load_balance(cs))
-			rebuild_sched_domains_locked();
+			request_rebuild_sched_domains();
 	}
 
 	return 0;
@@ -1342,8 +1398,9 @@ static int update_flag(cpuset_flagbits_t bit, struct cpuset *cs,
 	cs->flags = trialcs->flags;
 	spin_unlock_irq(&callback_lock);
 
-	if (!cpumask_empty(trialcs->cpus_allowed) && balance_flag_changed)
-		rebuild_sched_domains_locked();
+	if (!cpumask_empty(trialcs->cpus_allowed) && balance_flag_changed &&
+	    sched_domains_depend_on(cs))
+		request_rebuild_sched_domains();
 
 	if (spread_flag_changed)
 		update_tasks_flags(cs);
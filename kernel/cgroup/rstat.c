@@ -1,10 +1,24 @@
 #include "cgroup-internal.h"
 
+#include <linux/moduleparam.h>
 #include <linux/sched/cputime.h>
 
 static DEFINE_SPINLOCK(cgroup_rstat_lock);
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
 
+/*
+ * Maximum age of the stats returned by the lazy flushes.  Zero makes
+ * every flush exact.
+ */
+static unsigned int cgroup_rstat_flush_ms;
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "cgroup."
+
+module_param_named(rstat_flush_ms, cgroup_rstat_flush_ms, uint, 0644);
+
 static void cgroup_base_stat_flush(struct cgroup *cgrp, int cpu);
 
 static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
@@ -153,6 +167,12 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 
 	lockdep_assert_held(&cgroup_rstat_lock);
 
+	/*
+	 * Stamp before walking, updates racing with the walk are not
+	 * covered by this flush.
+	 */
+	cgrp->rstat_flush_time = jiffies;
+
 	for_each_possible_cpu(cpu) {
 		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
 						       cpu);
@@ -183,6 +203,29 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 	}
 }
 
+/*
+ * Whether the stats of @cgrp are older than cgroup_rstat_flush_ms.  A
+ * flush of an ancestor also flushed @cgrp, so the whole ancestry is
+ * checked.
+ */
+static bool cgroup_rstat_stale(struct cgroup *cgrp)
+{
+	unsigned long max_age = msecs_to_jiffies(READ_ONCE(cgroup_rstat_flush_ms));
+
+	if (!max_age)
+		return true;
+
+	for (; cgrp; cgrp = cgroup_parent(cgrp)) {
+		unsigned long flush_time = READ_ONCE(cgrp->rstat_flush_time);
+
+		/* zero means never flushed */
+		if (flush_time && time_before(jiffies, flush_time + max_age))
+			return false;
+	}
+
+	return true;
+}
+
 /**
  * cgroup_rstat_flush - flush stats in @cgrp's subtree
  * @cgrp: target cgroup
@@ -205,6 +248,28 @@ void cgroup_rstat_flush(struct cgroup *cgrp)
 	spin_unlock_irq(&cgroup_rstat_lock);
 }
 
+/**
+ * cgroup_rstat_flush_lazy - flush stats in @cgrp's subtree if too old
+ * @cgrp: target cgroup
+ *
+ * Same as cgroup_rstat_flush() except that the flush is skipped if the
+ * stats of @cgrp were flushed less than cgroup.rstat_flush_ms ago, so
+ * frequent readers of large hierarchies don't keep flushing and
+ * contending on cgroup_rstat_lock.  The stats may be stale by up to
+ * that duration.  The staleness is checked again under the lock, so
+ * concurrent lazy readers result in a single flush.
+ *
+ * This function may block.
+ */
+void cgroup_rstat_flush_lazy(struct cgroup *cgrp)
+{
+	if (!cgroup_rstat_stale(cgrp))
+		return;
+
+	cgroup_rstat_flush_hold_lazy(cgrp);
+	cgroup_rstat_flush_release();
+}
+
 /**
  * cgroup_rstat_flush_irqsafe - irqsafe version of cgroup_rstat_flush()
  * @cgrp: target cgroup
@@ -237,6 +302,25 @@ void cgroup_rstat_flush_hold(struct cgroup *cgrp)
 	cgroup_rstat_flush_locked(cgrp, true);
 }
 
+/**
+ * cgroup_rstat_flush_hold_lazy - lazily flush stats in @cgrp's subtree and hold
+ * @cgrp: target cgroup
+ *
+ * Same as cgroup_rstat_flush_hold() but with the bounded staleness of
+ * cgroup_rstat_flush_lazy().  Must be paired with
+ * cgroup_rstat_flush_release().
+ *
+ * This function may block.
+ */
+void cgroup_rstat_flush_hold_lazy(struct cgroup *cgrp)
+	__acquires(&cgroup_rstat_lock)
+{
+	might_sleep();
+	spin_lock_irq(&cgroup_rstat_lock);
+	if (cgroup_rstat_stale(cgrp))
+		cgroup_rstat_flush_locked(cgrp, true);
+}
+
 /**
  * cgroup_rstat_flush_release - release cgroup_rstat_flush_hold()
  */
@@ -400,7 +484,7 @@ void cgroup_base_stat_cputime_show(struct seq_file *seq)
 	if (!cgroup_parent(cgrp))
 		return;
 
-	cgroup_rstat_flush_hold(cgrp);
+	cgroup_rstat_flush_hold_lazy(cgrp);
 	usage = cgrp->bstat.cputime.sum_exec_runtime;
 	cputime_adjust(&cgrp->bstat.cputime, &cgrp->prev_cputime, &utime, &stime);
 	cgroup_rstat_flush_release();
@@ -5795,6 +5795,27 @@ void perf_event_wakeup(struct perf_event *event)
 	}
 }
 
+/*
+ * Wake up the readers of all the events sharing @rb, after a wakeup
+ * got deferred by perf_output_wakeup_defer().
+ */
+void ring_buffer_wakeup_all(struct ring_buffer *rb)
+{
+	struct perf_event *event;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(event, &rb->event_list, rb_entry) {
+		wake_up_all(&event->waitq);
+
+		if (event->pending_kill) {
+			kill_fasync(perf_event_fasync(event), SIGIO,
+				    event->pending_kill);
+			event->pending_kill = 0;
+		}
+	}
+	rcu_read_unlock();
+}
+
 static void perf_pending_event(struct irq_work *entry)
 {
 	struct perf_event *event = container_of(entry,
@@ -5814,7 +5835,8 @@ static void perf_pending_event(struct irq_work *entry)
 
 	if (event->pending_wakeup) {
 		event->pending_wakeup = 0;
-		perf_event_wakeup(event);
+		if (!perf_output_wakeup_defer(event))
+			perf_event_wakeup(event);
 	}
 
 	if (rctx >= 0)
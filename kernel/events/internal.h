@@ -3,6 +3,7 @@
 #define _KERNEL_EVENTS_INTERNAL_H
 
 #include <linux/hardirq.h>
+#include <linux/hrtimer.h>
 #include <linux/uaccess.h>
 
 /* Buffer handling */
@@ -28,6 +29,11 @@ struct ring_buffer {
 	local_t				wakeup;		/* wakeup stamp      */
 	local_t				lost;		/* nr records lost   */
 
+	/* wakeup rate limiting */
+	struct hrtimer			wakeup_timer;
+	atomic_t			wakeup_armed;
+	u64				wakeup_stamp;	/* last wakeup, ns   */
+
 	long				watermark;	/* wakeup watermark  */
 	long				aux_watermark;
 	/* poll crap */
@@ -77,6 +83,8 @@ static inline void rb_toggle_paused(struct ring_buffer *rb, bool pause)
 extern struct ring_buffer *
 rb_alloc(int nr_pages, long watermark, int cpu, int flags);
 extern void perf_event_wakeup(struct perf_event *event);
+extern void ring_buffer_wakeup_all(struct ring_buffer *rb);
+extern bool perf_output_wakeup_defer(struct perf_event *event);
 extern int rb_alloc_aux(struct ring_buffer *rb, struct perf_event *event,
 			pgoff_t pgoff, int nr_pages, long watermark, int flags);
 extern void rb_free_aux(struct ring_buffer *rb);
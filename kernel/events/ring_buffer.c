@@ -15,17 +15,100 @@
 #include <linux/circ_buf.h>
 #include <linux/poll.h>
 #include <linux/nospec.h>
+#include <linux/sysctl.h>
+#include <linux/debugfs.h>
 
 #include "internal.h"
 
+/*
+ * Minimum interval between two wakeups of the readers of a buffer, the
+ * wakeups happening earlier are merged into a single deferred one.
+ */
+static unsigned int sysctl_perf_event_wakeup_min_us __read_mostly;
+
+/* reader wakeups issued and merged into a later one, for debugfs */
+static DEFINE_PER_CPU(unsigned long, perf_rb_wakeups);
+static DEFINE_PER_CPU(unsigned long, perf_rb_wakeups_coalesced);
+
 static void perf_output_wakeup(struct perf_output_handle *handle)
 {
-	atomic_set(&handle->rb->poll, EPOLLIN);
+	struct ring_buffer *rb = handle->rb;
+
+	atomic_set(&rb->poll, EPOLLIN);
+
+	if (READ_ONCE(sysctl_perf_event_wakeup_min_us)) {
+		/*
+		 * A deferred wakeup is pending and will cover this data
+		 * too, spare the irq_work. Orders the data_head store
+		 * against the ->wakeup_armed load, matches the barrier in
+		 * rb_wakeup_timer().
+		 */
+		smp_mb();
+		if (atomic_read(&rb->wakeup_armed)) {
+			this_cpu_inc(perf_rb_wakeups_coalesced);
+			return;
+		}
+	}
 
 	handle->event->pending_wakeup = 1;
 	irq_work_queue(&handle->event->pending);
 }
 
+static enum hrtimer_restart rb_wakeup_timer(struct hrtimer *timer)
+{
+	struct ring_buffer *rb = container_of(timer, struct ring_buffer,
+					      wakeup_timer);
+
+	rb->wakeup_stamp = ktime_get_ns();
+	atomic_set(&rb->wakeup_armed, 0);
+	smp_mb__after_atomic();
+
+	this_cpu_inc(perf_rb_wakeups);
+	ring_buffer_wakeup_all(rb);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Called from the event irq_work before waking up the readers. If the
+ * previous wakeup of the buffer is more recent than
+ * perf_event_wakeup_min_us, the wakeup is deferred to the buffer
+ * timer, which wakes up all the readers of the buffer at once.
+ *
+ * Returns true if the wakeup was deferred.
+ */
+bool perf_output_wakeup_defer(struct perf_event *event)
+{
+	unsigned int min_us = READ_ONCE(sysctl_perf_event_wakeup_min_us);
+	struct ring_buffer *rb;
+	bool defer = false;
+	u64 now, next;
+
+	rcu_read_lock();
+	rb = rcu_dereference(event->rb);
+	if (!rb)
+		goto unlock;
+
+	now = ktime_get_ns();
+	next = rb->wakeup_stamp + (u64)min_us * NSEC_PER_USEC;
+
+	if (min_us && now < next) {
+		if (!atomic_xchg(&rb->wakeup_armed, 1))
+			hrtimer_start(&rb->wakeup_timer, ns_to_ktime(next - now),
+				      HRTIMER_MODE_REL);
+		this_cpu_inc(perf_rb_wakeups_coalesced);
+		defer = true;
+	} else {
+		rb->wakeup_stamp = now;
+		this_cpu_inc(perf_rb_wakeups);
+	}
+
+unlock:
+	rcu_read_unlock();
+
+	return defer;
+}
+
 /*
  * We need to ensure a later event_id doesn't publish a head when a former
  * event isn't done writing. However since we need to deal with NMIs we
@@ -290,6 +373,9 @@ ring_buffer_init(struct ring_buffer *rb, long watermark, int flags)
 	INIT_LIST_HEAD(&rb->event_list);
 	spin_lock_init(&rb->event_lock);
 
+	hrtimer_init(&rb->wakeup_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	rb->wakeup_timer.function = rb_wakeup_timer;
+
 	/*
 	 * perf_output_begin() only checks rb->paused, therefore
 	 * rb->paused must be true if we have no pages for output.
@@ -769,6 +855,8 @@ void rb_free(struct ring_buffer *rb)
 {
 	int i;
 
+	hrtimer_cancel(&rb->wakeup_timer);
+
 	perf_mmap_free_page((unsigned long)rb->user_page);
 	for (i = 0; i < rb->nr_pages; i++)
 		perf_mmap_free_page((unsigned long)rb->data_pages[i]);
@@ -818,6 +906,7 @@ static void rb_free_work(struct work_struct *work)
 
 void rb_free(struct ring_buffer *rb)
 {
+	hrtimer_cancel(&rb->wakeup_timer);
 	schedule_work(&rb->work);
 }
 
@@ -877,3 +966,57 @@ perf_mmap_to_page(struct ring_buffer *rb, unsigned long pgoff)
 
 	return __perf_mmap_to_page(rb, pgoff);
 }
+
+static struct ctl_table perf_rb_sysctl_table[] = {
+	{
+		.procname	= "perf_event_wakeup_min_us",
+		.data		= &sysctl_perf_event_wakeup_min_us,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
+	{ }
+};
+
+static u64 perf_rb_sum(unsigned long __percpu *cnt)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += *per_cpu_ptr(cnt, cpu);
+
+	return sum;
+}
+
+static int perf_rb_wakeups_get(void *data, u64 *val)
+{
+	*val = perf_rb_sum(&perf_rb_wakeups);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(perf_rb_wakeups_fops, perf_rb_wakeups_get, NULL,
+			 "%llu\n");
+
+static int perf_rb_wakeups_coalesced_get(void *data, u64 *val)
+{
+	*val = perf_rb_sum(&perf_rb_wakeups_coalesced);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(perf_rb_wakeups_coalesced_fops,
+			 perf_rb_wakeups_coalesced_get, NULL, "%llu\n");
+
+static int __init perf_rb_sysctl_init(void)
+{
+	struct dentry *dir;
+
+	register_sysctl("kernel", perf_rb_sysctl_table);
+
+	/* how well kernel.perf_event_wakeup_min_us merges wakeups */
+	dir = debugfs_create_dir("perf_rb", NULL);
+	debugfs_create_file_unsafe("wakeups", 0444, dir, NULL,
+				   &perf_rb_wakeups_fops);
+	debugfs_create_file_unsafe("wakeups_coalesced", 0444, dir, NULL,
+				   &perf_rb_wakeups_coalesced_fops);
+	return 0;
+}
+device_initcall(perf_rb_sysctl_init);
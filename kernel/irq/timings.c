@@ -18,6 +18,28 @@ DEFINE_STATIC_KEY_FALSE(irq_timing_enabled);
 
 DEFINE_PER_CPU(struct irq_timings, irq_timings);
 
+/*
+ * An interval is considered on-period when it does not deviate from
+ * the estimated period by more than 1/8th of it. Each on-period
+ * interval increases the confidence by one, each off-period interval
+ * halves it.
+ */
+#define IRQT_JITTER_SHIFT	3
+#define IRQT_CONFIDENCE_MAX	16
+
+/*
+ * Minimal confidence for a source to be taken into account when
+ * looking for the next event at idle time.
+ */
+#define IRQT_CONFIDENCE_MIN	8
+
+/*
+ * A periodic source may skip a few events (eg. a dropped video frame
+ * or an idle TSN cycle). Up to this number of consecutive periods can
+ * be missed before the prediction is considered lost.
+ */
+#define IRQT_MAX_MISSED		4
+
 struct irqt_stat {
 	u64	next_evt;
 	u64	last_ts;
@@ -25,19 +47,51 @@ struct irqt_stat {
 	u32	avg;
 	u32	nr_samples;
 	int	anomalies;
+	int	confidence;
 	int	valid;
 };
 
 static DEFINE_IDR(irqt_stats);
 
+/**
+ * irq_timings_enable - start recording the interrupts timings
+ *
+ * The calls are reference counted, so several users (eg. the idle
+ * governor and a network driver) can enable the timings independently.
+ */
 void irq_timings_enable(void)
 {
-	static_branch_enable(&irq_timing_enabled);
+	static_branch_inc(&irq_timing_enabled);
 }
+EXPORT_SYMBOL_GPL(irq_timings_enable);
 
 void irq_timings_disable(void)
 {
-	static_branch_disable(&irq_timing_enabled);
+	static_branch_dec(&irq_timing_enabled);
+}
+EXPORT_SYMBOL_GPL(irq_timings_disable);
+
+/*
+ * Returns the multiple of the estimated period @interval corresponds
+ * to, or zero if @interval is not a multiple of the period within
+ * the jitter tolerance.
+ */
+static unsigned int irqs_period_multiple(struct irqt_stat *irqs, u64 interval)
+{
+	u64 tolerance = irqs->avg >> IRQT_JITTER_SHIFT;
+	unsigned int k;
+
+	if (!irqs->avg)
+		return 0;
+
+	k = div64_u64(interval + (irqs->avg >> 1), irqs->avg);
+	if (!k || k > IRQT_MAX_MISSED + 1)
+		return 0;
+
+	if (abs((s64)(interval - (u64)k * irqs->avg)) > tolerance)
+		return 0;
+
+	return k;
 }
 
 /**
@@ -102,12 +156,21 @@ void irq_timings_disable(void)
  * rule of thumb in statistics, cf. "30 samples" on Internet). When
  * there are three consecutive anomalies, the statistics are resetted.
  *
+ * An anomaly which is a multiple of the period is not a peak but one
+ * or several missed events of a periodic source, it does not count as
+ * an anomaly and leaves the model untouched.
+ *
+ * On top of the average and the variance, a confidence level is
+ * tracked: it tells how regular the source has been recently, with
+ * respect to the jitter tolerance, and lets the consumers of the
+ * prediction decide if it is worth acting on it.
  */
 static void irqs_update(struct irqt_stat *irqs, u64 ts)
 {
 	u64 old_ts = irqs->last_ts;
-	u64 variance = 0;
+	s64 variance;
 	u64 interval;
+	u32 weight;
 	s64 diff;
 
 	/*
@@ -146,28 +209,28 @@ static void irqs_update(struct irqt_stat *irqs, u64 ts)
 	 */
 	diff = interval - irqs->avg;
 
-	/*
-	 * Increment the number of samples.
-	 */
-	irqs->nr_samples++;
-
-	/*
-	 * Online variance divided by the number of elements if there
-	 * is more than one sample.  Normally the formula is division
-	 * by nr_samples - 1 but we assume the number of element will be
-	 * more than 32 and dividing by 32 instead of 31 is enough
-	 * precise.
-	 */
-	if (likely(irqs->nr_samples > 1))
-		variance = irqs->variance >> IRQ_TIMINGS_SHIFT;
-
 	/*
 	 * The rule of thumb in statistics for the normal distribution
 	 * is having at least 30 samples in order to have the model to
 	 * apply. Values outside the interval are considered as an
-	 * anomaly.
+	 * anomaly, unless they are within the jitter tolerance: a very
+	 * regular source has a tiny variance which must not turn every
+	 * nanosecond of deviation into an anomaly.
 	 */
-	if ((irqs->nr_samples >= 30) && ((diff * diff) > (9 * variance))) {
+	if ((irqs->nr_samples >= 30) && ((diff * diff) > (9 * irqs->variance)) &&
+	    (abs(diff) > (irqs->avg >> IRQT_JITTER_SHIFT))) {
+
+		/*
+		 * A multiple of the period means we missed some
+		 * events, the source is still periodic.
+		 */
+		if (irqs_period_multiple(irqs, interval) > 1) {
+			irqs->next_evt = ts + irqs->avg;
+			return;
+		}
+
+		irqs->confidence >>= 1;
+
 		/*
 		 * After three consecutive anomalies, we reset the
 		 * stats as it is no longer stable enough.
@@ -177,14 +240,36 @@ static void irqs_update(struct irqt_stat *irqs, u64 ts)
 			irqs->last_ts = ts;
 			return;
 		}
-	} else {
+
 		/*
-		 * The anomalies must be consecutives, so at this
-		 * point, we reset the anomalies counter.
+		 * The peak is discarded, do not let it pollute the
+		 * model.
 		 */
-		irqs->anomalies = 0;
+		irqs->next_evt = ts + irqs->avg;
+		return;
 	}
 
+	/*
+	 * Increment the number of samples.
+	 */
+	irqs->nr_samples++;
+
+	/*
+	 * The model gives the same weight to all the samples until
+	 * IRQ_TIMINGS_SIZE of them are collected, so the average
+	 * converges quickly at the beginning of a sequence, then it
+	 * becomes an exponential moving average giving 1/32th of
+	 * weight to the new value, so the model follows a slowly
+	 * drifting period.
+	 */
+	weight = min_t(u32, irqs->nr_samples, IRQ_TIMINGS_SIZE);
+
+	/*
+	 * The anomalies must be consecutives, so at this
+	 * point, we reset the anomalies counter.
+	 */
+	irqs->anomalies = 0;
+
 	/*
 	 * The interrupt is considered stable enough to try to predict
 	 * the next event on it.
@@ -200,17 +285,30 @@ static void irqs_update(struct irqt_stat *irqs, u64 ts)
 	 * to be computed here first.
 	 *
 	 */
-	irqs->avg = irqs->avg + (diff >> IRQ_TIMINGS_SHIFT);
+	irqs->avg = irqs->avg + div_s64(diff, weight);
 
 	/*
 	 * Online variance algorithm:
 	 *
-	 *  new_variance = variance + (value - average) x (value - new_average)
+	 *  new_variance = variance +
+	 *    ((value - average) x (value - new_average) - variance) / count
 	 *
 	 * Warning: irqs->avg is updated with the line above, hence
 	 * 'interval - irqs->avg' is no longer equal to 'diff'
 	 */
-	irqs->variance = irqs->variance + (diff * (interval - irqs->avg));
+	variance = diff * (s64)(interval - irqs->avg);
+	irqs->variance = irqs->variance +
+		div_s64(variance - (s64)irqs->variance, weight);
+
+	/*
+	 * Update the confidence: the interval must be close to the
+	 * period, regardless of the variance which can be large if
+	 * the source is not periodic.
+	 */
+	if (abs((s64)(interval - irqs->avg)) <= (irqs->avg >> IRQT_JITTER_SHIFT))
+		irqs->confidence = min(irqs->confidence + 1, IRQT_CONFIDENCE_MAX);
+	else
+		irqs->confidence >>= 1;
 
 	/*
 	 * Update the next event
@@ -218,6 +316,66 @@ static void irqs_update(struct irqt_stat *irqs, u64 ts)
 	irqs->next_evt = ts + irqs->avg;
 }
 
+/*
+ * Returns the next expected event for @irqs after @now, or U64_MAX if
+ * the source is not predictable enough. If the expected event is
+ * already late within the jitter tolerance, it is considered imminent
+ * and @now is returned. If it is later than that, some periods were
+ * missed and the next one is projected.
+ */
+static u64 irqs_next_event(struct irqt_stat *irqs, u64 now)
+{
+	u64 late;
+	unsigned int k;
+
+	if (!irqs->valid || !irqs->avg)
+		return U64_MAX;
+
+	if (irqs->next_evt > now)
+		return irqs->next_evt;
+
+	late = now - irqs->next_evt;
+	if (late <= (irqs->avg >> IRQT_JITTER_SHIFT))
+		return now;
+
+	k = div64_u64(late, irqs->avg) + 1;
+	if (k > IRQT_MAX_MISSED)
+		return U64_MAX;
+
+	return irqs->next_evt + (u64)k * irqs->avg;
+}
+
+/*
+ * Inject measured irq/timestamp of the local circular buffer into the
+ * statistical model, consuming the buffer. Must be called with the
+ * local interrupts disabled.
+ *
+ * Number of elements in the circular buffer: If it happens it was
+ * flushed before, then the number of elements could be smaller than
+ * IRQ_TIMINGS_SIZE, so the count is used, otherwise the array size is
+ * used as we wrapped. The index begins from zero when we did not
+ * wrap. That could be done in a nicer way with the proper circular
+ * array structure type but with the cost of extra computation in the
+ * interrupt handler hot path. We choose efficiency.
+ */
+static void irq_timings_flush(struct irq_timings *irqts)
+{
+	struct irqt_stat __percpu *s;
+	u64 ts;
+	int i, irq;
+
+	for (i = irqts->count & IRQ_TIMINGS_MASK,
+		     irqts->count = min(IRQ_TIMINGS_SIZE, irqts->count);
+	     irqts->count > 0; irqts->count--, i = (i + 1) & IRQ_TIMINGS_MASK) {
+
+		irq = irq_timing_decode(irqts->values[i], &ts);
+
+		s = idr_find(&irqt_stats, irq);
+		if (s)
+			irqs_update(this_cpu_ptr(s), ts);
+	}
+}
+
 /**
  * irq_timings_next_event - Return when the next event is supposed to arrive
  *
@@ -249,8 +407,8 @@ u64 irq_timings_next_event(u64 now)
 	struct irq_timings *irqts = this_cpu_ptr(&irq_timings);
 	struct irqt_stat *irqs;
 	struct irqt_stat __percpu *s;
-	u64 ts, next_evt = U64_MAX;
-	int i, irq = 0;
+	u64 evt, next_evt = U64_MAX;
+	int i;
 
 	/*
 	 * This function must be called with the local irq disabled in
@@ -259,46 +417,21 @@ u64 irq_timings_next_event(u64 now)
 	 */
 	lockdep_assert_irqs_disabled();
 
-	/*
-	 * Number of elements in the circular buffer: If it happens it
-	 * was flushed before, then the number of elements could be
-	 * smaller than IRQ_TIMINGS_SIZE, so the count is used,
-	 * otherwise the array size is used as we wrapped. The index
-	 * begins from zero when we did not wrap. That could be done
-	 * in a nicer way with the proper circular array structure
-	 * type but with the cost of extra computation in the
-	 * interrupt handler hot path. We choose efficiency.
-	 *
-	 * Inject measured irq/timestamp to the statistical model
-	 * while decrementing the counter because we consume the data
-	 * from our circular buffer.
-	 */
-	for (i = irqts->count & IRQ_TIMINGS_MASK,
-		     irqts->count = min(IRQ_TIMINGS_SIZE, irqts->count);
-	     irqts->count > 0; irqts->count--, i = (i + 1) & IRQ_TIMINGS_MASK) {
-
-		irq = irq_timing_decode(irqts->values[i], &ts);
-
-		s = idr_find(&irqt_stats, irq);
-		if (s) {
-			irqs = this_cpu_ptr(s);
-			irqs_update(irqs, ts);
-		}
-	}
+	irq_timings_flush(irqts);
 
 	/*
 	 * Look in the list of interrupts' statistics, the earliest
-	 * next event.
+	 * next event of the sources we are confident enough about.
 	 */
 	idr_for_each_entry(&irqt_stats, s, i) {
 
 		irqs = this_cpu_ptr(s);
 
-		if (!irqs->valid)
+		if (irqs->confidence < IRQT_CONFIDENCE_MIN)
 			continue;
 
-		if (irqs->next_evt <= now) {
-			irq = i;
+		evt = irqs_next_event(irqs, now);
+		if (evt == now) {
 			next_evt = now;
 
 			/*
@@ -310,15 +443,67 @@ u64 irq_timings_next_event(u64 now)
 			break;
 		}
 
-		if (irqs->next_evt < next_evt) {
-			irq = i;
-			next_evt = irqs->next_evt;
-		}
+		if (evt < next_evt)
+			next_evt = evt;
 	}
 
 	return next_evt;
 }
 
+/**
+ * irq_timings_predict - Predict the next occurrence of an interrupt
+ *
+ * @irq: the interrupt number
+ * @now: the current time, as returned by local_clock()
+ * @next_evt: where the expected time of the next interrupt is stored
+ *
+ * Drivers can use this function to anticipate a periodic interrupt,
+ * for instance by starting to busy poll the device shortly before the
+ * expected event instead of waiting for the interrupt. The timings
+ * must have been enabled with irq_timings_enable().
+ *
+ * The statistics are per CPU, so this function must be called on the
+ * CPU the interrupt is affine to, typically from the handler or the
+ * NAPI poll routine of the device. The local records are injected in
+ * the model before computing the prediction.
+ *
+ * Returns the confidence in the prediction in percent, zero meaning
+ * @next_evt is not reliable at all, or -ENOENT if there is no
+ * prediction for this interrupt.
+ */
+int irq_timings_predict(unsigned int irq, u64 now, u64 *next_evt)
+{
+	struct irqt_stat __percpu *s;
+	struct irqt_stat *irqs;
+	unsigned long flags;
+	int confidence;
+	u64 evt;
+
+	local_irq_save(flags);
+
+	irq_timings_flush(this_cpu_ptr(&irq_timings));
+
+	s = idr_find(&irqt_stats, irq);
+	if (!s) {
+		local_irq_restore(flags);
+		return -ENOENT;
+	}
+
+	irqs = this_cpu_ptr(s);
+	evt = irqs_next_event(irqs, now);
+	confidence = irqs->confidence;
+
+	local_irq_restore(flags);
+
+	if (evt == U64_MAX)
+		return -ENOENT;
+
+	*next_evt = evt;
+
+	return confidence * 100 / IRQT_CONFIDENCE_MAX;
+}
+EXPORT_SYMBOL_GPL(irq_timings_predict);
+
 void irq_timings_free(int irq)
 {
 	struct irqt_stat __percpu *s;
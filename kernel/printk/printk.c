@@ -41,10 +41,12 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
 #include <linux/sched/debug.h>
+#include <linux/sched/rt.h>
 #include <linux/sched/task_stack.h>
 
 #include <linux/uaccess.h>
@@ -1884,6 +1886,112 @@ int vprintk_store(int facility, int level,
 			  dict, dictlen, text, text_len);
 }
 
+#ifdef CONFIG_PRINTK_CONSOLE_KTHREAD
+/*
+ * When enabled, the consoles are not driven from the context calling
+ * printk() but from a dedicated kthread, so the callers never wait
+ * for a slow console (eg. a serial port at 115200 bauds) to drain.
+ */
+static bool printk_console_kthread = true;
+module_param_named(console_kthread, printk_console_kthread, bool, 0444);
+
+static int printk_console_kthread_prio;
+module_param_named(console_kthread_prio, printk_console_kthread_prio, int, 0444);
+
+static int printk_console_kthread_cpu = -1;
+module_param_named(console_kthread_cpu, printk_console_kthread_cpu, int, 0444);
+
+static struct task_struct *printk_kthread __read_mostly;
+
+/*
+ * The consoles are driven synchronously until the kthread is running,
+ * and whenever the messages might never get out otherwise: oops,
+ * panic, and reboot or power off.
+ */
+static bool printk_console_offload(void)
+{
+	if (!READ_ONCE(printk_kthread) || oops_in_progress)
+		return false;
+
+	if (atomic_read(&panic_cpu) != PANIC_CPU_INVALID)
+		return false;
+
+	return system_state <= SYSTEM_RUNNING;
+}
+
+static int printk_kthread_func(void *data)
+{
+	unsigned long flags;
+	bool pending;
+
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+
+		/* resume_console() flushes what was held back */
+		logbuf_lock_irqsave(flags);
+		pending = !console_suspended && console_seq != log_next_seq;
+		logbuf_unlock_irqrestore(flags);
+
+		if (!pending)
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		/* Sleepable, console_unlock() reschedules between records */
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static void printk_kthread_start(void)
+{
+	struct sched_param param = {
+		.sched_priority = printk_console_kthread_prio,
+	};
+	struct task_struct *tsk;
+	int cpu = printk_console_kthread_cpu;
+
+	if (!printk_console_kthread)
+		return;
+
+	tsk = kthread_create(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("failed to start the console kthread (%ld)\n",
+		       PTR_ERR(tsk));
+		return;
+	}
+
+	if (param.sched_priority > 0) {
+		param.sched_priority = min(param.sched_priority,
+					   MAX_USER_RT_PRIO - 1);
+		sched_setscheduler_nocheck(tsk, SCHED_FIFO, &param);
+	}
+
+	/* Not bound: the affinity can be changed from userspace later */
+	if (cpu >= 0 && cpu < nr_cpu_ids && cpu_online(cpu))
+		set_cpus_allowed_ptr(tsk, cpumask_of(cpu));
+
+	wake_up_process(tsk);
+
+	/* Pairs with the lockless check in printk_console_offload() */
+	smp_store_release(&printk_kthread, tsk);
+}
+
+static void printk_kthread_wake(void)
+{
+	wake_up_process(printk_kthread);
+}
+#else
+static inline bool printk_console_offload(void)
+{
+	return false;
+}
+
+static inline void printk_kthread_start(void) { }
+static inline void printk_kthread_wake(void) { }
+#endif /* CONFIG_PRINTK_CONSOLE_KTHREAD */
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
@@ -1905,8 +2013,15 @@ asmlinkage int vprintk_emit(int facility, int level,
 	printed_len = vprintk_store(facility, level, dict, dictlen, fmt, args);
 	logbuf_unlock_irqrestore(flags);
 
-	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	/*
+	 * If called from the scheduler, we can not call up(). Otherwise
+	 * either leave the consoles to the printk kthread, which is
+	 * woken up from irq_work as we might hold scheduler locks, or
+	 * drive them synchronously.
+	 */
+	if (printk_console_offload()) {
+		defer_console_output();
+	} else if (!in_sched) {
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -2029,6 +2144,7 @@ static void call_console_drivers(const char *ext_text, size_t ext_len,
 static size_t msg_print_text(const struct printk_log *msg,
 			     bool syslog, char *buf, size_t size) { return 0; }
 static bool suppress_message_printing(int level) { return false; }
+static void printk_kthread_start(void) { }
 
 #endif /* CONFIG_PRINTK */
 
@@ -2854,6 +2970,7 @@ static int __init printk_late_init(void)
 	ret = cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN, "printk:online",
 					console_cpu_notify, NULL);
 	WARN_ON(ret < 0);
+	printk_kthread_start();
 	return 0;
 }
 late_initcall(printk_late_init);
@@ -2872,8 +2989,10 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
+		if (printk_console_offload())
+			printk_kthread_wake();
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -225,6 +225,42 @@ extern UDItype __udiv_qrnnd(UDItype *, UDItype, UDItype, UDItype);
 #define UDIV_TIME 100
 #endif /* __arm__ */
 
+/***************************************
+	**************  ARM64  ****************
+	***************************************/
+#if defined(__aarch64__) && W_TYPE_SIZE == 64
+#define add_ssaaaa(sh, sl, ah, al, bh, bl) \
+	__asm__ ("adds %1, %4, %5\n" \
+		"adc  %0, %2, %3" \
+	: "=r" (sh), \
+		"=&r" (sl) \
+	: "r" ((UDItype)(ah)), \
+		"r" ((UDItype)(bh)), \
+		"r" ((UDItype)(al)), \
+		"rI" ((UDItype)(bl)) \
+	: "cc")
+#define sub_ddmmss(sh, sl, ah, al, bh, bl) \
+	__asm__ ("subs %1, %4, %5\n" \
+		"sbc  %0, %2, %3" \
+	: "=r" (sh), \
+		"=&r" (sl) \
+	: "r" ((UDItype)(ah)), \
+		"r" ((UDItype)(bh)), \
+		"r" ((UDItype)(al)), \
+		"rI" ((UDItype)(bl)) \
+	: "cc")
+#define umul_ppmm(ph, pl, m0, m1) \
+do { \
+	UDItype __m0 = (m0), __m1 = (m1); \
+	__asm__ ("umulh %0, %1, %2" \
+	: "=r" (ph) \
+	: "r" (__m0), \
+		"r" (__m1)); \
+	(pl) = __m0 * __m1; \
+} while (0)
+#define UMUL_TIME 5
+#endif /* __aarch64__ */
+
 /***************************************
 	**************  CLIPPER  **************
 	***************************************/
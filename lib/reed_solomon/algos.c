@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Algorithm list and algorithm selection for the 8 bit symbol encoder
+ * and syndrome calculation.
+ *
+ * Every candidate is checked against the generic alpha_to/index_of code
+ * before it is benchmarked; the fastest one which passes is used.
+ */
+#include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include "internal.h"
+
+#define RS_TIME_JIFFIES_LG2	3
+
+/* The pstore / ramoops default code: 8 bit symbols, 16 parity symbols */
+#define RS_TEST_GFPOLY		0x11d
+#define RS_TEST_NROOTS		16
+#define RS_TEST_LEN		(255 - RS_TEST_NROOTS)
+
+struct rs_calls rs_call = {
+	.encode8	= rs_table_encode8,
+	.syndrome8	= rs_table_syndrome8,
+	.name		= "table",
+};
+
+static const struct rs_calls * const rs_algos[] = {
+#if defined(CONFIG_X86) && defined(CONFIG_AS_SSSE3)
+	&rs_calls_ssse3,
+#endif
+#ifdef CONFIG_KERNEL_MODE_NEON
+	&rs_calls_neon,
+#endif
+	&rs_calls_table,
+	NULL
+};
+
+/* Syndromes the way decode_rs.c forms them, in polynomial form */
+static void rs_syndrome8_ref(struct rs_codec *rs, const uint8_t *data,
+			     int len, uint8_t invmsk, uint16_t *syn)
+{
+	uint16_t s;
+	int i, j;
+
+	for (i = 0; i < rs->nroots; i++) {
+		for (s = 0, j = 0; j < len; j++) {
+			if (s)
+				s = rs->alpha_to[rs_modnn(rs, rs->index_of[s] +
+						(rs->fcr + i) * rs->prim)];
+			s ^= data[j] ^ invmsk;
+		}
+		syn[i] = s;
+	}
+}
+
+static int __init rs_test_algo(const struct rs_calls *algo,
+			       struct rs_control *rsc, uint8_t *data)
+{
+	static const int lens[] = { 1, 15, 16, 17, 64, 100, RS_TEST_LEN };
+	uint16_t ref[RS_TEST_NROOTS], res[RS_TEST_NROOTS];
+	struct rs_codec *rs = rsc->codec;
+	uint8_t invmsk;
+	int i, n;
+
+	for (i = 0; i < ARRAY_SIZE(lens); i++) {
+		invmsk = (i & 1) ? 0xff : 0;
+
+		memset(ref, 0, sizeof(ref));
+		memset(res, 0, sizeof(res));
+		__encode_rs8(rsc, data, lens[i], ref, invmsk);
+		algo->encode8(rs, data, lens[i], res, invmsk);
+		for (n = 0; n < RS_TEST_NROOTS; n++)
+			if (ref[n] != res[n])
+				return -EINVAL;
+
+		rs_syndrome8_ref(rs, data, lens[i], invmsk, ref);
+		algo->syndrome8(rs, data, lens[i], invmsk, res);
+		for (n = 0; n < RS_TEST_NROOTS; n++)
+			if (ref[n] != res[n])
+				return -EINVAL;
+	}
+	return 0;
+}
+
+static int __init rs_select_algo(void)
+{
+	const struct rs_calls * const *algo;
+	const struct rs_calls *best = NULL;
+	unsigned long perf, bestperf = 0, j0, j1;
+	uint16_t par[RS_TEST_NROOTS];
+	struct rs_control *rsc;
+	uint8_t *data;
+
+	if (!IS_ENABLED(CONFIG_REED_SOLOMON_ENC8) &&
+	    !IS_ENABLED(CONFIG_REED_SOLOMON_DEC8))
+		return 0;
+
+	rsc = init_rs(8, RS_TEST_GFPOLY, 0, 1, RS_TEST_NROOTS);
+	data = kmalloc(RS_TEST_LEN, GFP_KERNEL);
+	if (!rsc || !data || !rsc->codec->enc_tab) {
+		pr_err("rslib: no memory for algorithm selection\n");
+		goto out;
+	}
+	prandom_bytes(data, RS_TEST_LEN);
+
+	for (algo = rs_algos; *algo; algo++) {
+		if ((*algo)->valid && !(*algo)->valid())
+			continue;
+
+		if (rs_test_algo(*algo, rsc, data)) {
+			pr_err("rslib: %s failed self-test\n", (*algo)->name);
+			continue;
+		}
+
+		perf = 0;
+
+		preempt_disable();
+		j0 = jiffies;
+		while ((j1 = jiffies) == j0)
+			cpu_relax();
+		while (time_before(jiffies,
+				   j1 + (1 << RS_TIME_JIFFIES_LG2))) {
+			memset(par, 0, sizeof(par));
+			(*algo)->encode8(rsc->codec, data, RS_TEST_LEN, par, 0);
+			(*algo)->syndrome8(rsc->codec, data, RS_TEST_LEN, 0,
+					   par);
+			perf++;
+		}
+		preempt_enable();
+
+		if (perf > bestperf) {
+			bestperf = perf;
+			best = *algo;
+		}
+		pr_info("rslib: %-8s %5ld MB/s\n", (*algo)->name,
+			(perf * RS_TEST_LEN * HZ) >> (20 + RS_TIME_JIFFIES_LG2));
+	}
+
+	if (best) {
+		pr_info("rslib: using algorithm %s\n", best->name);
+		rs_call = *best;
+	}
+out:
+	kfree(data);
+	free_rs(rsc);
+	return 0;
+}
+
+static void __exit rs_exit(void)
+{
+}
+
+subsys_initcall(rs_select_algo);
+module_exit(rs_exit);
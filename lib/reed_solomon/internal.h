@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Reed Solomon library internals shared by the table driven and SIMD
+ * implementations of the 8 bit symbol hot paths.
+ */
+#ifndef _RS_INTERNAL_H
+#define _RS_INTERNAL_H
+
+#include <linux/rslib.h>
+
+/*
+ * Encoder rows are padded so a 16 byte vector load of the last row stays
+ * inside the allocation.
+ */
+#define RS_ENC_TAB_PAD		16
+
+/**
+ * struct rs_calls - 8 bit symbol primitives
+ * @encode8:	Feed @len data bytes through the parity LFSR held in @par
+ * @syndrome8:	Evaluate @len data bytes at the generator roots; the
+ *		result in @syn is in polynomial form
+ * @valid:	Returns nonzero if the implementation can run on this CPU
+ * @name:	Name used when reporting the selection
+ *
+ * Both operate on codecs with mm == 8 which have their lookup tables
+ * (enc_tab, syn_tab, syn_nib) set up; the caller validates @len.
+ */
+struct rs_calls {
+	void (*encode8)(const struct rs_codec *rs, const uint8_t *data,
+			int len, uint16_t *par, uint8_t invmsk);
+	void (*syndrome8)(const struct rs_codec *rs, const uint8_t *data,
+			  int len, uint8_t invmsk, uint16_t *syn);
+	int (*valid)(void);
+	const char *name;
+};
+
+/* Selected at init, the table driven implementation until then */
+extern struct rs_calls rs_call;
+
+extern const struct rs_calls rs_calls_table;
+extern const struct rs_calls rs_calls_neon;
+extern const struct rs_calls rs_calls_ssse3;
+
+void rs_table_encode8(const struct rs_codec *rs, const uint8_t *data,
+		      int len, uint16_t *par, uint8_t invmsk);
+void rs_table_syndrome8(const struct rs_codec *rs, const uint8_t *data,
+			int len, uint8_t invmsk, uint16_t *syn);
+
+/* The generic alpha_to/index_of encoder, reference for the self-test */
+int __encode_rs8(struct rs_control *rsc, uint8_t *data, int len,
+		 uint16_t *par, uint16_t invmsk);
+
+#endif
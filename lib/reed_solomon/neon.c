@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NEON accelerated 8 bit symbol Reed Solomon primitives
+ */
+#include <linux/kernel.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+#include "internal.h"
+
+/* Below this the NEON context switch costs more than it saves */
+#define RS_NEON_MIN_LEN		64
+
+void __rs_encode8_neon(const uint8_t *tab, int nroots, const uint8_t *data,
+		       int len, uint8_t *par, uint8_t invmsk);
+void __rs_syndrome8_neon(const uint8_t *nib, const uint8_t *data,
+			 int blocks, uint8_t invmsk, uint8_t *out);
+
+static int rs_has_neon(void)
+{
+	return cpu_has_neon();
+}
+
+static void rs_encode8_neon(const struct rs_codec *rs, const uint8_t *data,
+			    int len, uint16_t *par, uint8_t invmsk)
+{
+	int nroots = rs->nroots;
+	uint8_t p[16];
+	int i;
+
+	if (nroots > 16 || len < RS_NEON_MIN_LEN || !may_use_simd()) {
+		rs_table_encode8(rs, data, len, par, invmsk);
+		return;
+	}
+
+	for (i = 0; i < nroots; i++)
+		p[i] = par[i];
+
+	kernel_neon_begin();
+	__rs_encode8_neon(rs->enc_tab, nroots, data, len, p, invmsk);
+	kernel_neon_end();
+
+	for (i = 0; i < nroots; i++)
+		par[i] = p[i];
+}
+
+static void rs_syndrome8_neon(const struct rs_codec *rs, const uint8_t *data,
+			      int len, uint8_t invmsk, uint16_t *syn)
+{
+	int blocks = len / 16;
+	const uint8_t *mul;
+	uint8_t acc[16], s;
+	int i, j;
+
+	if (len < RS_NEON_MIN_LEN || !may_use_simd()) {
+		rs_table_syndrome8(rs, data, len, invmsk, syn);
+		return;
+	}
+
+	kernel_neon_begin();
+	for (i = 0; i < rs->nroots; i++) {
+		__rs_syndrome8_neon(rs->syn_nib + i * 32, data, blocks,
+				    invmsk, acc);
+
+		/* Fold the lanes, then finish the tail bytes */
+		mul = rs->syn_tab + (i << 8);
+		for (s = 0, j = 0; j < 16; j++)
+			s = mul[s] ^ acc[j];
+		for (j = blocks * 16; j < len; j++)
+			s = mul[s] ^ data[j] ^ invmsk;
+		syn[i] = s;
+	}
+	kernel_neon_end();
+}
+
+const struct rs_calls rs_calls_neon = {
+	.encode8	= rs_encode8_neon,
+	.syndrome8	= rs_syndrome8_neon,
+	.valid		= rs_has_neon,
+	.name		= "neon",
+};
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * NEON inner loops for the 8 bit symbol Reed Solomon primitives
+ */
+
+#include <arm_neon.h>
+
+static const uint8x16_t x0f = {
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+};
+
+static const uint8x16_t lanes = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+};
+
+#ifdef CONFIG_ARM
+/*
+ * AArch32 does not provide this intrinsic natively because it does not
+ * implement the underlying instruction. AArch32 only provides a 64-bit
+ * wide vtbl.8 instruction, so use that instead.
+ */
+static uint8x16_t vqtbl1q_u8(uint8x16_t a, uint8x16_t b)
+{
+	union {
+		uint8x16_t	val;
+		uint8x8x2_t	pair;
+	} __a = { a };
+
+	return vcombine_u8(vtbl2_u8(__a.pair, vget_low_u8(b)),
+			   vtbl2_u8(__a.pair, vget_high_u8(b)));
+}
+#endif
+
+/*
+ * The whole parity register (nroots <= 16) lives in one vector. Each
+ * data byte shifts it down by one lane and xors in the feedback row.
+ */
+void __rs_encode8_neon(const uint8_t *tab, int nroots, const uint8_t *data,
+		       int len, uint8_t *par, uint8_t invmsk)
+{
+	uint8x16_t mask = vcltq_u8(lanes, vdupq_n_u8(nroots));
+	uint8x16_t zero = vdupq_n_u8(0);
+	uint8x16_t p = vandq_u8(vld1q_u8(par), mask);
+	uint8x16_t row;
+	uint8_t fb;
+
+	while (len--) {
+		fb = *data++ ^ invmsk ^ vgetq_lane_u8(p, 0);
+		row = vandq_u8(vld1q_u8(tab + fb * nroots), mask);
+		p = veorq_u8(vextq_u8(p, zero, 1), row);
+	}
+	vst1q_u8(par, p);
+}
+
+/*
+ * Horner's rule on 16 interleaved lanes: lane k accumulates the bytes
+ * at offsets k, k + 16, ... multiplied by root^16 per step. The caller
+ * folds the lanes together with the plain root.
+ */
+void __rs_syndrome8_neon(const uint8_t *nib, const uint8_t *data,
+			 int blocks, uint8_t invmsk, uint8_t *out)
+{
+	uint8x16_t lo = vld1q_u8(nib);
+	uint8x16_t hi = vld1q_u8(nib + 16);
+	uint8x16_t inv = vdupq_n_u8(invmsk);
+	uint8x16_t acc = vdupq_n_u8(0);
+
+	while (blocks--) {
+		acc = veorq_u8(vqtbl1q_u8(lo, vandq_u8(acc, x0f)),
+			       vqtbl1q_u8(hi, vshrq_n_u8(acc, 4)));
+		acc = veorq_u8(acc, veorq_u8(vld1q_u8(data), inv));
+		data += 16;
+	}
+	vst1q_u8(out, acc);
+}
@@ -37,6 +37,8 @@
 #include <linux/slab.h>
 #include <linux/mutex.h>
 
+#include "internal.h"
+
 enum {
 	RS_DECODE_LAMBDA,
 	RS_DECODE_SYN,
@@ -54,6 +56,68 @@ static LIST_HEAD(codec_list);
 /* Protection for the list */
 static DEFINE_MUTEX(rslistlock);
 
+/*
+ * Build the lookup tables used by the table driven and SIMD 8 bit symbol
+ * code. They are an optimization only: if they can't be allocated the
+ * codec falls back to the generic code.
+ */
+static void codec_init_tables(struct rs_codec *rs, gfp_t gfp)
+{
+	int nroots = rs->nroots;
+	uint8_t *row, *mul, *nib;
+	int f, i, v;
+
+	if (rs->mm != 8 || (!IS_ENABLED(CONFIG_REED_SOLOMON_ENC8) &&
+			    !IS_ENABLED(CONFIG_REED_SOLOMON_DEC8)))
+		return;
+
+	rs->enc_tab = kzalloc(256 * nroots + RS_ENC_TAB_PAD, gfp);
+	rs->syn_tab = kmalloc_array(nroots, 256, gfp);
+	rs->syn_nib = kmalloc_array(nroots, 32, gfp);
+	if (!rs->enc_tab || !rs->syn_tab || !rs->syn_nib)
+		goto err;
+
+	/*
+	 * Feedback row of the encoder LFSR for each feedback symbol, the
+	 * same terms encode_rs.c adds after the shift.
+	 */
+	for (f = 1; f < 256; f++) {
+		row = rs->enc_tab + f * nroots;
+		for (i = 0; i < nroots; i++)
+			row[i] = rs->alpha_to[rs_modnn(rs, rs->index_of[f] +
+						rs->genpoly[nroots - 1 - i])];
+	}
+
+	/*
+	 * Multiplication by root i and the low / high nibble tables for
+	 * multiplication by root i to the 16th power, which lets SIMD code
+	 * run Horner's rule on 16 bytes at a time.
+	 */
+	for (i = 0; i < nroots; i++) {
+		mul = rs->syn_tab + (i << 8);
+		mul[0] = 0;
+		for (v = 1; v < 256; v++)
+			mul[v] = rs->alpha_to[rs_modnn(rs, rs->index_of[v] +
+						(rs->fcr + i) * rs->prim)];
+
+		nib = rs->syn_nib + i * 32;
+		for (v = 0; v < 16; v++) {
+			nib[v] = v;
+			nib[v + 16] = v << 4;
+		}
+		for (f = 0; f < 16; f++)
+			for (v = 0; v < 32; v++)
+				nib[v] = mul[nib[v]];
+	}
+	return;
+
+err:
+	kfree(rs->syn_nib);
+	kfree(rs->syn_tab);
+	kfree(rs->enc_tab);
+	rs->syn_nib = rs->syn_tab = rs->enc_tab = NULL;
+}
+
 /**
  * codec_init - Initialize a Reed-Solomon codec
  * @symsize:	symbol size, bits (1-8)
@@ -152,6 +216,8 @@ static struct rs_codec *codec_init(int symsize, int gfpoly, int (*gffunc)(int),
 	for (i = 0; i <= nroots; i++)
 		rs->genpoly[i] = rs->index_of[rs->genpoly[i]];
 
+	codec_init_tables(rs, gfp);
+
 	rs->users = 1;
 	list_add(&rs->list, &codec_list);
 	return rs;
@@ -185,6 +251,9 @@ void free_rs(struct rs_control *rs)
 	cd->users--;
 	if(!cd->users) {
 		list_del(&cd->list);
+		kfree(cd->syn_nib);
+		kfree(cd->syn_tab);
+		kfree(cd->enc_tab);
 		kfree(cd->alpha_to);
 		kfree(cd->index_of);
 		kfree(cd->genpoly);
@@ -312,6 +381,13 @@ struct rs_control *init_rs_non_canonical(int symsize, int (*gffunc)(int),
 }
 EXPORT_SYMBOL_GPL(init_rs_non_canonical);
 
+/* Generic 8 bit data width encoder, also the reference for the self-test */
+int __encode_rs8(struct rs_control *rsc, uint8_t *data, int len, uint16_t *par,
+		 uint16_t invmsk)
+{
+#include "encode_rs.c"
+}
+
 #ifdef CONFIG_REED_SOLOMON_ENC8
 /**
  *  encode_rs8 - Calculate the parity for data values (8bit data width)
@@ -328,12 +404,56 @@ EXPORT_SYMBOL_GPL(init_rs_non_canonical);
 int encode_rs8(struct rs_control *rsc, uint8_t *data, int len, uint16_t *par,
 	       uint16_t invmsk)
 {
-#include "encode_rs.c"
+	struct rs_codec *rs = rsc->codec;
+	int pad = rs->nn - rs->nroots - len;
+
+	if (!rs->enc_tab)
+		return __encode_rs8(rsc, data, len, par, invmsk);
+
+	/* Check length parameter for validity */
+	if (pad < 0 || pad >= rs->nn)
+		return -ERANGE;
+
+	rs_call.encode8(rs, data, len, par, invmsk);
+	return 0;
 }
 EXPORT_SYMBOL_GPL(encode_rs8);
 #endif
 
 #ifdef CONFIG_REED_SOLOMON_DEC8
+static int __decode_rs8(struct rs_control *rsc, uint8_t *data, uint16_t *par,
+			int len, uint16_t *s, int no_eras, int *eras_pos,
+			uint16_t invmsk, uint16_t *corr)
+{
+#include "decode_rs.c"
+}
+
+/*
+ * Table driven / SIMD syndrome calculation over data and parity. Leaves
+ * the syndromes in index form in @syn, ready for the second decoder
+ * stage, and returns 0 if the codeword is clean.
+ */
+static int rs_syndrome8(struct rs_codec *rs, const uint8_t *data,
+			const uint16_t *par, int len, uint8_t invmsk,
+			uint16_t *syn)
+{
+	uint16_t syn_error = 0;
+	const uint8_t *mul;
+	uint8_t s;
+	int i, j;
+
+	rs_call.syndrome8(rs, data, len, invmsk, syn);
+
+	for (i = 0; i < rs->nroots; i++) {
+		mul = rs->syn_tab + (i << 8);
+		for (s = syn[i], j = 0; j < rs->nroots; j++)
+			s = mul[s] ^ (uint8_t)par[j];
+		syn_error |= s;
+		syn[i] = rs->index_of[s];
+	}
+	return syn_error;
+}
+
 /**
  *  decode_rs8 - Decode codeword (8bit data width)
  *  @rsc:	the rs control structure
@@ -360,7 +480,17 @@ int decode_rs8(struct rs_control *rsc, uint8_t *data, uint16_t *par, int len,
 	       uint16_t *s, int no_eras, int *eras_pos, uint16_t invmsk,
 	       uint16_t *corr)
 {
-#include "decode_rs.c"
+	struct rs_codec *rs = rsc->codec;
+	int pad = rs->nn - rs->nroots - len;
+
+	if (!s && rs->syn_tab && pad >= 0 && pad < rs->nn) {
+		s = rsc->buffers + RS_DECODE_SYN * (rs->nroots + 1);
+		/* No errors: data[] is a codeword, return it unmodified */
+		if (!rs_syndrome8(rs, data, par, len, invmsk, s))
+			return 0;
+	}
+	return __decode_rs8(rsc, data, par, len, s, no_eras, eras_pos, invmsk,
+			    corr);
 }
 EXPORT_SYMBOL_GPL(decode_rs8);
 #endif
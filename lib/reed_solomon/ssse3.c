@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * SSSE3 accelerated 8 bit symbol Reed Solomon syndrome calculation
+ *
+ * Same split nibble scheme as the NEON code, with pshufb doing the
+ * 16 entry table lookups. The encoder LFSR is a serial byte at a time
+ * dependency chain which pshufb does not help with, so it uses the
+ * table driven implementation.
+ */
+#ifdef CONFIG_AS_SSSE3
+
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <asm/cpufeature.h>
+#include <asm/fpu/api.h>
+#include "internal.h"
+
+/* Below this the FPU context switch costs more than it saves */
+#define RS_SSSE3_MIN_LEN	64
+
+static int rs_has_ssse3(void)
+{
+	return boot_cpu_has(X86_FEATURE_XMM) &&
+		boot_cpu_has(X86_FEATURE_XMM2) &&
+		boot_cpu_has(X86_FEATURE_SSSE3);
+}
+
+static void rs_syndrome8_ssse3(const struct rs_codec *rs, const uint8_t *data,
+			       int len, uint8_t invmsk, uint16_t *syn)
+{
+	static const u8 __aligned(16) x0f[16] = {
+		 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+		 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f};
+	int blocks = len / 16;
+	const uint8_t *nib, *mul, *p;
+	u8 __aligned(16) inv[16];
+	u8 __aligned(16) acc[16];
+	uint8_t s;
+	int i, j;
+
+	if (len < RS_SSSE3_MIN_LEN || !irq_fpu_usable()) {
+		rs_table_syndrome8(rs, data, len, invmsk, syn);
+		return;
+	}
+
+	memset(inv, invmsk, sizeof(inv));
+
+	kernel_fpu_begin();
+
+	asm volatile("movdqa %0,%%xmm7" : : "m" (x0f[0]));
+	asm volatile("movdqa %0,%%xmm6" : : "m" (inv));
+
+	for (i = 0; i < rs->nroots; i++) {
+		nib = rs->syn_nib + i * 32;
+		asm volatile("movdqu %0,%%xmm0" : : "m" (nib[0]));
+		asm volatile("movdqu %0,%%xmm1" : : "m" (nib[16]));
+		asm volatile("pxor   %xmm2,%xmm2");
+
+		/* xmm2 = xmm2 * root^16 ^ data, see __rs_syndrome8_neon() */
+		for (j = 0, p = data; j < blocks; j++, p += 16) {
+			asm volatile("movdqa %xmm2,%xmm3");
+			asm volatile("psraw  $4,%xmm3");
+			asm volatile("pand   %xmm7,%xmm2");
+			asm volatile("pand   %xmm7,%xmm3");
+			asm volatile("movdqa %xmm0,%xmm4");
+			asm volatile("pshufb %xmm2,%xmm4");
+			asm volatile("movdqa %xmm1,%xmm2");
+			asm volatile("pshufb %xmm3,%xmm2");
+			asm volatile("pxor   %xmm4,%xmm2");
+			asm volatile("movdqu %0,%%xmm3" : : "m" (p[0]));
+			asm volatile("pxor   %xmm6,%xmm3");
+			asm volatile("pxor   %xmm3,%xmm2");
+		}
+		asm volatile("movdqa %%xmm2,%0" : "=m" (acc));
+
+		/* Fold the lanes, then finish the tail bytes */
+		mul = rs->syn_tab + (i << 8);
+		for (s = 0, j = 0; j < 16; j++)
+			s = mul[s] ^ acc[j];
+		for (j = blocks * 16; j < len; j++)
+			s = mul[s] ^ data[j] ^ invmsk;
+		syn[i] = s;
+	}
+
+	kernel_fpu_end();
+}
+
+const struct rs_calls rs_calls_ssse3 = {
+	.encode8	= rs_table_encode8,
+	.syndrome8	= rs_syndrome8_ssse3,
+	.valid		= rs_has_ssse3,
+	.name		= "ssse3",
+};
+
+#else
+#warning "your version of binutils lacks SSSE3 support"
+#endif
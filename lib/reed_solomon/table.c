@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Table driven 8 bit symbol encoder and syndrome calculation
+ *
+ * The generic code does a log/antilog lookup and a modulo reduction for
+ * every multiplication. For 8 bit symbols the per codec tables set up in
+ * codec_init() turn each step into a single byte lookup.
+ */
+#include <linux/kernel.h>
+#include "internal.h"
+
+void rs_table_encode8(const struct rs_codec *rs, const uint8_t *data,
+		      int len, uint16_t *par, uint8_t invmsk)
+{
+	int nroots = rs->nroots;
+	const uint8_t *row;
+	int i, j;
+
+	for (i = 0; i < len; i++) {
+		/* Feedback row for the feedback symbol, all zero for 0 */
+		row = rs->enc_tab + ((data[i] ^ invmsk ^ par[0]) & 0xff) * nroots;
+		for (j = 0; j < nroots - 1; j++)
+			par[j] = par[j + 1] ^ row[j];
+		par[nroots - 1] = row[nroots - 1];
+	}
+}
+
+void rs_table_syndrome8(const struct rs_codec *rs, const uint8_t *data,
+			int len, uint8_t invmsk, uint16_t *syn)
+{
+	const uint8_t *m0, *m1, *m2, *m3;
+	uint8_t s0, s1, s2, s3, d;
+	int nroots = rs->nroots;
+	int i, j;
+
+	/*
+	 * Horner's rule per root. Four roots are interleaved to hide the
+	 * latency of the dependent table lookups.
+	 */
+	for (i = 0; i + 4 <= nroots; i += 4) {
+		m0 = rs->syn_tab + (i << 8);
+		m1 = m0 + 256;
+		m2 = m1 + 256;
+		m3 = m2 + 256;
+		s0 = s1 = s2 = s3 = 0;
+		for (j = 0; j < len; j++) {
+			d = data[j] ^ invmsk;
+			s0 = m0[s0] ^ d;
+			s1 = m1[s1] ^ d;
+			s2 = m2[s2] ^ d;
+			s3 = m3[s3] ^ d;
+		}
+		syn[i] = s0;
+		syn[i + 1] = s1;
+		syn[i + 2] = s2;
+		syn[i + 3] = s3;
+	}
+	for (; i < nroots; i++) {
+		m0 = rs->syn_tab + (i << 8);
+		s0 = 0;
+		for (j = 0; j < len; j++)
+			s0 = m0[s0] ^ data[j] ^ invmsk;
+		syn[i] = s0;
+	}
+}
+
+const struct rs_calls rs_calls_table = {
+	.encode8	= rs_table_encode8,
+	.syndrome8	= rs_table_syndrome8,
+	.valid		= NULL,
+	.name		= "table",
+};
@@ -17,6 +17,27 @@
 
 #include "xz_private.h"
 
+#if defined(__KERNEL__) && !defined(XZ_PREBOOT)
+#include <linux/crc32.h>
+
+/*
+ * This file is only built through decompress_unxz.c, which asks for the
+ * internal CRC32. The rest of the kernel already gets crc32_le() from
+ * xz_stream.h. When decompress_unxz.c is linked into the kernel proper to
+ * unpack the initramfs, crc32_le() is built in as well (XZ_DEC selects
+ * CRC32), so use it instead of the byte at a time table below. Its crc
+ * argument is the raw register, hence the inversions.
+ */
+XZ_EXTERN void xz_crc32_init(void)
+{
+}
+
+XZ_EXTERN uint32_t xz_crc32(const uint8_t *buf, size_t size, uint32_t crc)
+{
+	return ~crc32_le(~crc, buf, size);
+}
+#else
+
 /*
  * STATIC_RW_DATA is used in the pre-boot environment on some architectures.
  * See <linux/decompress/mm.h> for details.
@@ -57,3 +78,4 @@ XZ_EXTERN uint32_t xz_crc32(const uint8_t *buf, size_t size, uint32_t crc)
 
 	return ~crc;
 }
+#endif
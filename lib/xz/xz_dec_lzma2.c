@@ -346,6 +346,7 @@ static inline void dict_put(struct dictionary *dict, uint8_t byte)
 static bool dict_repeat(struct dictionary *dict, uint32_t *len, uint32_t dist)
 {
 	size_t back;
+	size_t gap;
 	uint32_t left;
 
 	if (dist >= dict->full || dist >= dict->size)
@@ -358,11 +359,35 @@ static bool dict_repeat(struct dictionary *dict, uint32_t *len, uint32_t dist)
 	if (dist >= dict->pos)
 		back += dict->end;
 
-	do {
-		dict->buf[dict->pos++] = dict->buf[back++];
-		if (back == dict->end)
-			back = 0;
-	} while (--left > 0);
+	if (left <= dict->end - back) {
+		/*
+		 * The source doesn't wrap around the end of the dictionary.
+		 * If it doesn't overlap the destination either, this is a
+		 * plain copy. Otherwise the bytes have to be copied one by
+		 * one in order, but without the wrap check. When the distance
+		 * reached back past the start of the buffer, the source lies
+		 * after the destination instead of before it.
+		 */
+		if (dist >= dict->pos)
+			gap = back - dict->pos;
+		else
+			gap = dist + 1;
+
+		if (left <= gap) {
+			memcpy(dict->buf + dict->pos, dict->buf + back, left);
+			dict->pos += left;
+		} else {
+			do {
+				dict->buf[dict->pos++] = dict->buf[back++];
+			} while (--left > 0);
+		}
+	} else {
+		do {
+			dict->buf[dict->pos++] = dict->buf[back++];
+			if (back == dict->end)
+				back = 0;
+		} while (--left > 0);
+	}
 
 	if (dict->full < dict->pos)
 		dict->full = dict->pos;
@@ -515,53 +540,68 @@ static __always_inline int rc_bit(struct rc_dec *rc, uint16_t *prob)
 	return bit;
 }
 
+/*
+ * The functions below decode several bits in a row. The kernel is built with
+ * -fno-strict-aliasing, so after every probability update the compiler would
+ * have to reload the range decoder state from memory. Instead they work on a
+ * local copy of it, which can stay in registers, and store it back once.
+ */
+
 /* Decode a bittree starting from the most significant bit. */
-static __always_inline uint32_t rc_bittree(struct rc_dec *rc,
+static __always_inline uint32_t rc_bittree(struct rc_dec *rcp,
 					   uint16_t *probs, uint32_t limit)
 {
+	struct rc_dec rc = *rcp;
 	uint32_t symbol = 1;
 
 	do {
-		if (rc_bit(rc, &probs[symbol]))
+		if (rc_bit(&rc, &probs[symbol]))
 			symbol = (symbol << 1) + 1;
 		else
 			symbol <<= 1;
 	} while (symbol < limit);
 
+	*rcp = rc;
 	return symbol;
 }
 
 /* Decode a bittree starting from the least significant bit. */
-static __always_inline void rc_bittree_reverse(struct rc_dec *rc,
+static __always_inline void rc_bittree_reverse(struct rc_dec *rcp,
 					       uint16_t *probs,
 					       uint32_t *dest, uint32_t limit)
 {
+	struct rc_dec rc = *rcp;
 	uint32_t symbol = 1;
 	uint32_t i = 0;
 
 	do {
-		if (rc_bit(rc, &probs[symbol])) {
+		if (rc_bit(&rc, &probs[symbol])) {
 			symbol = (symbol << 1) + 1;
 			*dest += 1 << i;
 		} else {
 			symbol <<= 1;
 		}
 	} while (++i < limit);
+
+	*rcp = rc;
 }
 
 /* Decode direct bits (fixed fifty-fifty probability) */
-static inline void rc_direct(struct rc_dec *rc, uint32_t *dest, uint32_t limit)
+static inline void rc_direct(struct rc_dec *rcp, uint32_t *dest, uint32_t limit)
 {
+	struct rc_dec rc = *rcp;
 	uint32_t mask;
 
 	do {
-		rc_normalize(rc);
-		rc->range >>= 1;
-		rc->code -= rc->range;
-		mask = (uint32_t)0 - (rc->code >> 31);
-		rc->code += rc->range & mask;
+		rc_normalize(&rc);
+		rc.range >>= 1;
+		rc.code -= rc.range;
+		mask = (uint32_t)0 - (rc.code >> 31);
+		rc.code += rc.range & mask;
 		*dest = (*dest << 1) + (mask + 1);
 	} while (--limit > 0);
+
+	*rcp = rc;
 }
 
 /********
@@ -592,6 +632,8 @@ static void lzma_literal(struct xz_dec_lzma2 *s)
 	if (lzma_state_is_literal(s->lzma.state)) {
 		symbol = rc_bittree(&s->rc, probs, 0x100);
 	} else {
+		struct rc_dec rc = s->rc;
+
 		symbol = 1;
 		match_byte = dict_get(&s->dict, s->lzma.rep0) << 1;
 		offset = 0x100;
@@ -601,7 +643,7 @@ static void lzma_literal(struct xz_dec_lzma2 *s)
 			match_byte <<= 1;
 			i = offset + match_bit + symbol;
 
-			if (rc_bit(&s->rc, &probs[i])) {
+			if (rc_bit(&rc, &probs[i])) {
 				symbol = (symbol << 1) + 1;
 				offset &= match_bit;
 			} else {
@@ -609,6 +651,8 @@ static void lzma_literal(struct xz_dec_lzma2 *s)
 				offset &= ~match_bit;
 			}
 		} while (symbol < 0x100);
+
+		s->rc = rc;
 	}
 
 	dict_put(&s->dict, (uint8_t)symbol);
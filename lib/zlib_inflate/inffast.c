@@ -4,6 +4,7 @@
  */
 
 #include <linux/zutil.h>
+#include <asm/unaligned.h>
 #include "inftrees.h"
 #include "inflate.h"
 #include "inffast.h"
@@ -38,6 +39,17 @@ get_unaligned16(const unsigned short *p)
 	return mm.us;
 }
 
+/*
+   With cheap unaligned accesses, copy matches eight bytes at a time and, on
+   64-bit, refill the bit buffer eight bytes at a time.
+ */
+#ifdef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+#  define INFLATE_CHUNK_COPY
+#  ifdef CONFIG_64BIT
+#    define INFLATE_WIDE_HOLD
+#  endif
+#endif
+
 #ifdef POSTINC
 #  define OFF 0
 #  define PUP(a) *(a)++
@@ -48,6 +60,85 @@ get_unaligned16(const unsigned short *p)
 #  define UP_UNALIGNED(a) get_unaligned16(++(a))
 #endif
 
+#ifdef INFLATE_CHUNK_COPY
+/* Smallest multiple of the distance that is at least eight */
+static const unsigned char chunk_step[8] = { 0, 8, 8, 9, 8, 10, 12, 14 };
+
+/*
+   Copy a match of len bytes from dist bytes back in the output, out being
+   the next byte to write. Works in eight byte chunks and may store up to
+   seven bytes past the end of the match, the caller makes sure there is
+   room for that. Distances below eight first copy just enough single bytes
+   to continue from a multiple of the distance which is at least eight back,
+   so a chunk never loads bytes it is about to store.
+ */
+static inline unsigned char *chunk_copy(unsigned char *out, unsigned dist,
+                                        unsigned len)
+{
+    const unsigned char *from = out - dist;
+    unsigned char *end = out + len;
+    unsigned n;
+
+    if (dist < 8) {
+        n = chunk_step[dist] - dist;
+        if (n > len)
+            n = len;
+        while (n--)
+            *out++ = *from++;
+        from = out - chunk_step[dist];
+    }
+    while (out < end) {
+        put_unaligned(get_unaligned((const u64 *)from), (u64 *)out);
+        from += 8;
+        out += 8;
+    }
+    return end;
+}
+
+/*
+   Copy a match which starts op bytes back in the sliding window: the window
+   part with memcpy(), in two pieces if it wraps around the end of the
+   window, then the rest from the output.
+ */
+static inline unsigned char *inflate_copy_window(unsigned char *out,
+        const unsigned char *limit, const unsigned char *window,
+        unsigned wsize, unsigned write, unsigned op, unsigned dist,
+        unsigned len)
+{
+    const unsigned char *from;
+    unsigned n;
+
+    if (write < op) {                   /* wrap around window, or write == 0 */
+        from = window + wsize + write - op;
+        n = op - write;
+    }
+    else {                              /* contiguous in window */
+        from = window + write - op;
+        n = op;
+    }
+    if (n > len)
+        n = len;
+    memcpy(out, from, n);
+    out += n;
+    len -= n;
+    if (len && write < op && write) {   /* some from start of window */
+        n = write < len ? write : len;
+        memcpy(out, window, n);
+        out += n;
+        len -= n;
+    }
+    if (!len)
+        return out;
+    if (len + 7 <= (unsigned)(limit - out))     /* rest from output */
+        return chunk_copy(out, dist, len);
+    from = out - dist;
+    do {
+        *out++ = *from++;
+    } while (--len);
+    return out;
+}
+#endif
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -93,6 +184,12 @@ void inflate_fast(z_streamp strm, unsigned start)
     unsigned char *out;         /* local strm->next_out */
     unsigned char *beg;         /* inflate()'s initial strm->next_out */
     unsigned char *end;         /* while out < end, enough space available */
+#ifdef INFLATE_CHUNK_COPY
+    unsigned char *limit;       /* end of the output buffer */
+#endif
+#ifdef INFLATE_WIDE_HOLD
+    const unsigned char *wlast; /* while in < wlast, eight bytes available */
+#endif
 #ifdef INFLATE_STRICT
     unsigned dmax;              /* maximum distance from zlib header */
 #endif
@@ -117,9 +214,15 @@ void inflate_fast(z_streamp strm, unsigned start)
     state = (struct inflate_state *)strm->state;
     in = strm->next_in - OFF;
     last = in + (strm->avail_in - 5);
+#ifdef INFLATE_WIDE_HOLD
+    wlast = strm->avail_in >= 8 ? in + (strm->avail_in - 7) : in;
+#endif
     out = strm->next_out - OFF;
     beg = out - (start - strm->avail_out);
     end = out + (strm->avail_out - 257);
+#ifdef INFLATE_CHUNK_COPY
+    limit = strm->next_out + strm->avail_out;
+#endif
 #ifdef INFLATE_STRICT
     dmax = state->dmax;
 #endif
@@ -137,10 +240,22 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
+#ifdef INFLATE_WIDE_HOLD
+        /*
+           One refill is enough for a whole length/distance pair. The bytes
+           loaded but not counted in bits are the next input bytes already in
+           place, which is why all refills use | rather than +.
+         */
+        if (bits < 48 && in < wlast) {
+            hold |= (unsigned long)get_unaligned_le64(in + OFF) << bits;
+            in += (63 - bits) >> 3;
+            bits |= 56;
+        }
+#endif
         if (bits < 15) {
-            hold += (unsigned long)(PUP(in)) << bits;
+            hold |= (unsigned long)(PUP(in)) << bits;
             bits += 8;
-            hold += (unsigned long)(PUP(in)) << bits;
+            hold |= (unsigned long)(PUP(in)) << bits;
             bits += 8;
         }
         this = lcode[hold & lmask];
@@ -157,7 +272,7 @@ void inflate_fast(z_streamp strm, unsigned start)
             op &= 15;                           /* number of extra bits */
             if (op) {
                 if (bits < op) {
-                    hold += (unsigned long)(PUP(in)) << bits;
+                    hold |= (unsigned long)(PUP(in)) << bits;
                     bits += 8;
                 }
                 len += (unsigned)hold & ((1U << op) - 1);
@@ -165,9 +280,9 @@ void inflate_fast(z_streamp strm, unsigned start)
                 bits -= op;
             }
             if (bits < 15) {
-                hold += (unsigned long)(PUP(in)) << bits;
+                hold |= (unsigned long)(PUP(in)) << bits;
                 bits += 8;
-                hold += (unsigned long)(PUP(in)) << bits;
+                hold |= (unsigned long)(PUP(in)) << bits;
                 bits += 8;
             }
             this = dcode[hold & dmask];
@@ -180,10 +295,10 @@ void inflate_fast(z_streamp strm, unsigned start)
                 dist = (unsigned)(this.val);
                 op &= 15;                       /* number of extra bits */
                 if (bits < op) {
-                    hold += (unsigned long)(PUP(in)) << bits;
+                    hold |= (unsigned long)(PUP(in)) << bits;
                     bits += 8;
                     if (bits < op) {
-                        hold += (unsigned long)(PUP(in)) << bits;
+                        hold |= (unsigned long)(PUP(in)) << bits;
                         bits += 8;
                     }
                 }
@@ -205,6 +320,10 @@ void inflate_fast(z_streamp strm, unsigned start)
                         state->mode = BAD;
                         break;
                     }
+#ifdef INFLATE_CHUNK_COPY
+                    out = inflate_copy_window(out + OFF, limit, window, wsize,
+                                              write, op, dist, len) - OFF;
+#else
                     from = window - OFF;
                     if (write == 0) {           /* very common case */
                         from += wsize - op;
@@ -256,7 +375,19 @@ void inflate_fast(z_streamp strm, unsigned start)
                         if (len > 1)
                             PUP(out) = PUP(from);
                     }
+#endif
+                }
+#ifdef INFLATE_CHUNK_COPY
+                else if (len + 7 <= (unsigned)(limit - (out + OFF))) {
+                    out = chunk_copy(out + OFF, dist, len) - OFF;
                 }
+                else {                          /* near the end of output */
+                    from = out - dist;
+                    do {
+                        PUP(out) = PUP(from);
+                    } while (--len);
+                }
+#else
                 else {
 		    unsigned short *sout;
 		    unsigned long loops;
@@ -303,6 +434,7 @@ void inflate_fast(z_streamp strm, unsigned start)
 		    if (len & 1)
 			PUP(out) = PUP(from);
                 }
+#endif
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
                 this = dcode[this.val + (hold & ((1U << op) - 1))];
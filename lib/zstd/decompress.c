@@ -65,19 +65,34 @@ typedef enum {
 	ZSTDds_skipFrame
 } ZSTD_dStage;
 
+/* FSE decoding table cell of a sequence field, with the field's value decoding folded in */
 typedef struct {
-	FSE_DTable LLTable[FSE_DTABLE_SIZE_U32(LLFSELog)];
-	FSE_DTable OFTable[FSE_DTABLE_SIZE_U32(OffFSELog)];
-	FSE_DTable MLTable[FSE_DTABLE_SIZE_U32(MLFSELog)];
+	U16 nextState;
+	BYTE nbAdditionalBits;
+	BYTE nbBits;
+	U32 baseValue;
+} ZSTD_seqSymbol;
+
+typedef struct {
+	U32 fastMode;
+	U32 tableLog;
+} ZSTD_seqSymbol_header;
+
+#define SEQSYMBOL_TABLE_SIZE(log) (1 + (1 << (log)))
+
+typedef struct {
+	ZSTD_seqSymbol LLTable[SEQSYMBOL_TABLE_SIZE(LLFSELog)];
+	ZSTD_seqSymbol OFTable[SEQSYMBOL_TABLE_SIZE(OffFSELog)];
+	ZSTD_seqSymbol MLTable[SEQSYMBOL_TABLE_SIZE(MLFSELog)];
 	HUF_DTable hufTable[HUF_DTABLE_SIZE(HufLog)]; /* can accommodate HUF_decompress4X */
 	U64 workspace[HUF_DECOMPRESS_WORKSPACE_SIZE_U32 / 2];
 	U32 rep[ZSTD_REP_NUM];
 } ZSTD_entropyTables_t;
 
 struct ZSTD_DCtx_s {
-	const FSE_DTable *LLTptr;
-	const FSE_DTable *MLTptr;
-	const FSE_DTable *OFTptr;
+	const ZSTD_seqSymbol *LLTptr;
+	const ZSTD_seqSymbol *MLTptr;
+	const ZSTD_seqSymbol *OFTptr;
 	const HUF_DTable *HUFptr;
 	ZSTD_entropyTables_t entropy;
 	const void *previousDstEnd; /* detect continuity */
@@ -568,201 +583,279 @@ size_t ZSTD_decodeLiteralsBlock(ZSTD_DCtx *dctx, const void *src, size_t srcSize
 	}
 }
 
-typedef union {
-	FSE_decode_t realData;
-	U32 alignedBy4;
-} FSE_decode_t4;
-
-static const FSE_decode_t4 LL_defaultDTable[(1 << LL_DEFAULTNORMLOG) + 1] = {
-    {{LL_DEFAULTNORMLOG, 1, 1}}, /* header : tableLog, fastMode, fastMode */
-    {{0, 0, 4}},		 /* 0 : base, symbol, bits */
-    {{16, 0, 4}},
-    {{32, 1, 5}},
-    {{0, 3, 5}},
-    {{0, 4, 5}},
-    {{0, 6, 5}},
-    {{0, 7, 5}},
-    {{0, 9, 5}},
-    {{0, 10, 5}},
-    {{0, 12, 5}},
-    {{0, 14, 6}},
-    {{0, 16, 5}},
-    {{0, 18, 5}},
-    {{0, 19, 5}},
-    {{0, 21, 5}},
-    {{0, 22, 5}},
-    {{0, 24, 5}},
-    {{32, 25, 5}},
-    {{0, 26, 5}},
-    {{0, 27, 6}},
-    {{0, 29, 6}},
-    {{0, 31, 6}},
-    {{32, 0, 4}},
-    {{0, 1, 4}},
-    {{0, 2, 5}},
-    {{32, 4, 5}},
-    {{0, 5, 5}},
-    {{32, 7, 5}},
-    {{0, 8, 5}},
-    {{32, 10, 5}},
-    {{0, 11, 5}},
-    {{0, 13, 6}},
-    {{32, 16, 5}},
-    {{0, 17, 5}},
-    {{32, 19, 5}},
-    {{0, 20, 5}},
-    {{32, 22, 5}},
-    {{0, 23, 5}},
-    {{0, 25, 4}},
-    {{16, 25, 4}},
-    {{32, 26, 5}},
-    {{0, 28, 6}},
-    {{0, 30, 6}},
-    {{48, 0, 4}},
-    {{16, 1, 4}},
-    {{32, 2, 5}},
-    {{32, 3, 5}},
-    {{32, 5, 5}},
-    {{32, 6, 5}},
-    {{32, 8, 5}},
-    {{32, 9, 5}},
-    {{32, 11, 5}},
-    {{32, 12, 5}},
-    {{0, 15, 6}},
-    {{32, 17, 5}},
-    {{32, 18, 5}},
-    {{32, 20, 5}},
-    {{32, 21, 5}},
-    {{32, 23, 5}},
-    {{32, 24, 5}},
-    {{0, 35, 6}},
-    {{0, 34, 6}},
-    {{0, 33, 6}},
-    {{0, 32, 6}},
+/* Base values and number of extra bits of the literal length, match length and offset codes */
+static const U32 LL_base[MaxLL + 1] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+	12, 13, 14, 15, 16, 18, 20, 22, 24, 28, 32, 40,
+	48, 64, 0x80, 0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000, 0x8000, 0x10000,
+};
+
+static const U32 ML_base[MaxML + 1] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26,
+	27, 28, 29, 30, 31, 32, 33, 34, 35, 37, 39, 41,
+	43, 47, 51, 59, 67, 83, 99, 0x83, 0x103, 0x203, 0x403, 0x803,
+	0x1003, 0x2003, 0x4003, 0x8003, 0x10003,
+};
+
+static const U32 OF_base[MaxOff + 1] = {
+	0, 1, 1, 5, 0xD, 0x1D, 0x3D, 0x7D, 0xFD, 0x1FD, 0x3FD, 0x7FD,
+	0xFFD, 0x1FFD, 0x3FFD, 0x7FFD, 0xFFFD, 0x1FFFD, 0x3FFFD, 0x7FFFD, 0xFFFFD, 0x1FFFFD, 0x3FFFFD, 0x7FFFFD,
+	0xFFFFFD, 0x1FFFFFD, 0x3FFFFFD, 0x7FFFFFD, 0xFFFFFFD,
+};
+
+static const U32 OF_bits[MaxOff + 1] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+	12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+	24, 25, 26, 27, 28,
+};
+
+static const ZSTD_seqSymbol LL_defaultDTable[(1 << LL_DEFAULTNORMLOG) + 1] = {
+    {1, 1, 1, LL_DEFAULTNORMLOG}, /* header : fastMode, tableLog */
+    {0, 0, 4, 0}, /* 0 : nextState, nbAddBits, nbBits, baseVal */
+    {16, 0, 4, 0},
+    {32, 0, 5, 1},
+    {0, 0, 5, 3},
+    {0, 0, 5, 4},
+    {0, 0, 5, 6},
+    {0, 0, 5, 7},
+    {0, 0, 5, 9},
+    {0, 0, 5, 10},
+    {0, 0, 5, 12},
+    {0, 0, 6, 14},
+    {0, 1, 5, 16},
+    {0, 1, 5, 20},
+    {0, 1, 5, 22},
+    {0, 2, 5, 28},
+    {0, 3, 5, 32},
+    {0, 4, 5, 48},
+    {32, 6, 5, 64},
+    {0, 7, 5, 0x80},
+    {0, 8, 6, 0x100},
+    {0, 10, 6, 0x400},
+    {0, 12, 6, 0x1000},
+    {32, 0, 4, 0},
+    {0, 0, 4, 1},
+    {0, 0, 5, 2},
+    {32, 0, 5, 4},
+    {0, 0, 5, 5},
+    {32, 0, 5, 7},
+    {0, 0, 5, 8},
+    {32, 0, 5, 10},
+    {0, 0, 5, 11},
+    {0, 0, 6, 13},
+    {32, 1, 5, 16},
+    {0, 1, 5, 18},
+    {32, 1, 5, 22},
+    {0, 2, 5, 24},
+    {32, 3, 5, 32},
+    {0, 3, 5, 40},
+    {0, 6, 4, 64},
+    {16, 6, 4, 64},
+    {32, 7, 5, 0x80},
+    {0, 9, 6, 0x200},
+    {0, 11, 6, 0x800},
+    {48, 0, 4, 0},
+    {16, 0, 4, 1},
+    {32, 0, 5, 2},
+    {32, 0, 5, 3},
+    {32, 0, 5, 5},
+    {32, 0, 5, 6},
+    {32, 0, 5, 8},
+    {32, 0, 5, 9},
+    {32, 0, 5, 11},
+    {32, 0, 5, 12},
+    {0, 0, 6, 15},
+    {32, 1, 5, 18},
+    {32, 1, 5, 20},
+    {32, 2, 5, 24},
+    {32, 2, 5, 28},
+    {32, 3, 5, 40},
+    {32, 4, 5, 48},
+    {0, 16, 6, 0x10000},
+    {0, 15, 6, 0x8000},
+    {0, 14, 6, 0x4000},
+    {0, 13, 6, 0x2000},
 }; /* LL_defaultDTable */
 
-static const FSE_decode_t4 ML_defaultDTable[(1 << ML_DEFAULTNORMLOG) + 1] = {
-    {{ML_DEFAULTNORMLOG, 1, 1}}, /* header : tableLog, fastMode, fastMode */
-    {{0, 0, 6}},		 /* 0 : base, symbol, bits */
-    {{0, 1, 4}},
-    {{32, 2, 5}},
-    {{0, 3, 5}},
-    {{0, 5, 5}},
-    {{0, 6, 5}},
-    {{0, 8, 5}},
-    {{0, 10, 6}},
-    {{0, 13, 6}},
-    {{0, 16, 6}},
-    {{0, 19, 6}},
-    {{0, 22, 6}},
-    {{0, 25, 6}},
-    {{0, 28, 6}},
-    {{0, 31, 6}},
-    {{0, 33, 6}},
-    {{0, 35, 6}},
-    {{0, 37, 6}},
-    {{0, 39, 6}},
-    {{0, 41, 6}},
-    {{0, 43, 6}},
-    {{0, 45, 6}},
-    {{16, 1, 4}},
-    {{0, 2, 4}},
-    {{32, 3, 5}},
-    {{0, 4, 5}},
-    {{32, 6, 5}},
-    {{0, 7, 5}},
-    {{0, 9, 6}},
-    {{0, 12, 6}},
-    {{0, 15, 6}},
-    {{0, 18, 6}},
-    {{0, 21, 6}},
-    {{0, 24, 6}},
-    {{0, 27, 6}},
-    {{0, 30, 6}},
-    {{0, 32, 6}},
-    {{0, 34, 6}},
-    {{0, 36, 6}},
-    {{0, 38, 6}},
-    {{0, 40, 6}},
-    {{0, 42, 6}},
-    {{0, 44, 6}},
-    {{32, 1, 4}},
-    {{48, 1, 4}},
-    {{16, 2, 4}},
-    {{32, 4, 5}},
-    {{32, 5, 5}},
-    {{32, 7, 5}},
-    {{32, 8, 5}},
-    {{0, 11, 6}},
-    {{0, 14, 6}},
-    {{0, 17, 6}},
-    {{0, 20, 6}},
-    {{0, 23, 6}},
-    {{0, 26, 6}},
-    {{0, 29, 6}},
-    {{0, 52, 6}},
-    {{0, 51, 6}},
-    {{0, 50, 6}},
-    {{0, 49, 6}},
-    {{0, 48, 6}},
-    {{0, 47, 6}},
-    {{0, 46, 6}},
+static const ZSTD_seqSymbol ML_defaultDTable[(1 << ML_DEFAULTNORMLOG) + 1] = {
+    {1, 1, 1, ML_DEFAULTNORMLOG}, /* header : fastMode, tableLog */
+    {0, 0, 6, 3}, /* 0 : nextState, nbAddBits, nbBits, baseVal */
+    {0, 0, 4, 4},
+    {32, 0, 5, 5},
+    {0, 0, 5, 6},
+    {0, 0, 5, 8},
+    {0, 0, 5, 9},
+    {0, 0, 5, 11},
+    {0, 0, 6, 13},
+    {0, 0, 6, 16},
+    {0, 0, 6, 19},
+    {0, 0, 6, 22},
+    {0, 0, 6, 25},
+    {0, 0, 6, 28},
+    {0, 0, 6, 31},
+    {0, 0, 6, 34},
+    {0, 1, 6, 37},
+    {0, 1, 6, 41},
+    {0, 2, 6, 47},
+    {0, 3, 6, 59},
+    {0, 4, 6, 83},
+    {0, 7, 6, 0x83},
+    {0, 9, 6, 0x203},
+    {16, 0, 4, 4},
+    {0, 0, 4, 5},
+    {32, 0, 5, 6},
+    {0, 0, 5, 7},
+    {32, 0, 5, 9},
+    {0, 0, 5, 10},
+    {0, 0, 6, 12},
+    {0, 0, 6, 15},
+    {0, 0, 6, 18},
+    {0, 0, 6, 21},
+    {0, 0, 6, 24},
+    {0, 0, 6, 27},
+    {0, 0, 6, 30},
+    {0, 0, 6, 33},
+    {0, 1, 6, 35},
+    {0, 1, 6, 39},
+    {0, 2, 6, 43},
+    {0, 3, 6, 51},
+    {0, 4, 6, 67},
+    {0, 5, 6, 99},
+    {0, 8, 6, 0x103},
+    {32, 0, 4, 4},
+    {48, 0, 4, 4},
+    {16, 0, 4, 5},
+    {32, 0, 5, 7},
+    {32, 0, 5, 8},
+    {32, 0, 5, 10},
+    {32, 0, 5, 11},
+    {0, 0, 6, 14},
+    {0, 0, 6, 17},
+    {0, 0, 6, 20},
+    {0, 0, 6, 23},
+    {0, 0, 6, 26},
+    {0, 0, 6, 29},
+    {0, 0, 6, 32},
+    {0, 16, 6, 0x10003},
+    {0, 15, 6, 0x8003},
+    {0, 14, 6, 0x4003},
+    {0, 13, 6, 0x2003},
+    {0, 12, 6, 0x1003},
+    {0, 11, 6, 0x803},
+    {0, 10, 6, 0x403},
 }; /* ML_defaultDTable */
 
-static const FSE_decode_t4 OF_defaultDTable[(1 << OF_DEFAULTNORMLOG) + 1] = {
-    {{OF_DEFAULTNORMLOG, 1, 1}}, /* header : tableLog, fastMode, fastMode */
-    {{0, 0, 5}},		 /* 0 : base, symbol, bits */
-    {{0, 6, 4}},
-    {{0, 9, 5}},
-    {{0, 15, 5}},
-    {{0, 21, 5}},
-    {{0, 3, 5}},
-    {{0, 7, 4}},
-    {{0, 12, 5}},
-    {{0, 18, 5}},
-    {{0, 23, 5}},
-    {{0, 5, 5}},
-    {{0, 8, 4}},
-    {{0, 14, 5}},
-    {{0, 20, 5}},
-    {{0, 2, 5}},
-    {{16, 7, 4}},
-    {{0, 11, 5}},
-    {{0, 17, 5}},
-    {{0, 22, 5}},
-    {{0, 4, 5}},
-    {{16, 8, 4}},
-    {{0, 13, 5}},
-    {{0, 19, 5}},
-    {{0, 1, 5}},
-    {{16, 6, 4}},
-    {{0, 10, 5}},
-    {{0, 16, 5}},
-    {{0, 28, 5}},
-    {{0, 27, 5}},
-    {{0, 26, 5}},
-    {{0, 25, 5}},
-    {{0, 24, 5}},
+static const ZSTD_seqSymbol OF_defaultDTable[(1 << OF_DEFAULTNORMLOG) + 1] = {
+    {1, 1, 1, OF_DEFAULTNORMLOG}, /* header : fastMode, tableLog */
+    {0, 0, 5, 0}, /* 0 : nextState, nbAddBits, nbBits, baseVal */
+    {0, 6, 4, 0x3D},
+    {0, 9, 5, 0x1FD},
+    {0, 15, 5, 0x7FFD},
+    {0, 21, 5, 0x1FFFFD},
+    {0, 3, 5, 5},
+    {0, 7, 4, 0x7D},
+    {0, 12, 5, 0xFFD},
+    {0, 18, 5, 0x3FFFD},
+    {0, 23, 5, 0x7FFFFD},
+    {0, 5, 5, 0x1D},
+    {0, 8, 4, 0xFD},
+    {0, 14, 5, 0x3FFD},
+    {0, 20, 5, 0xFFFFD},
+    {0, 2, 5, 1},
+    {16, 7, 4, 0x7D},
+    {0, 11, 5, 0x7FD},
+    {0, 17, 5, 0x1FFFD},
+    {0, 22, 5, 0x3FFFFD},
+    {0, 4, 5, 0xD},
+    {16, 8, 4, 0xFD},
+    {0, 13, 5, 0x1FFD},
+    {0, 19, 5, 0x7FFFD},
+    {0, 1, 5, 1},
+    {16, 6, 4, 0x3D},
+    {0, 10, 5, 0x3FD},
+    {0, 16, 5, 0xFFFD},
+    {0, 28, 5, 0xFFFFFFD},
+    {0, 27, 5, 0x7FFFFFD},
+    {0, 26, 5, 0x3FFFFFD},
+    {0, 25, 5, 0x1FFFFFD},
+    {0, 24, 5, 0xFFFFFD},
 }; /* OF_defaultDTable */
 
+/*! ZSTD_buildSeqSymbols() :
+ *  Builds the FSE decoding table of a sequence field and stores the base value
+ *  and extra bits count of each code in its cells, so that ZSTD_decodeSequence()
+ *  needs a single table lookup per field.
+ *  `workspace` must hold the intermediate FSE_DTable and FSE_buildDTable_wksp()'s workspace */
+static size_t ZSTD_buildSeqSymbols(ZSTD_seqSymbol *dt, const short *norm, unsigned max, unsigned tableLog, const U32 *baseValue,
+				   const U32 *nbAdditionalBits, void *workspace, size_t workspaceSize)
+{
+	FSE_DTable *const fseTable = (FSE_DTable *)workspace;
+	size_t const fseSize = FSE_DTABLE_SIZE_U32(tableLog) * sizeof(FSE_DTable);
+	const void *const cellPtr = fseTable + 1;
+	const FSE_decode_t *const cell = (const FSE_decode_t *)cellPtr;
+	U32 const tableSize = 1 << tableLog;
+	ZSTD_seqSymbol_header DTableH;
+	U32 u;
+
+	ZSTD_STATIC_ASSERT(sizeof(ZSTD_seqSymbol_header) == sizeof(ZSTD_seqSymbol));
+	if (fseSize > workspaceSize)
+		return ERROR(GENERIC);
+	{
+		size_t const errorCode = FSE_buildDTable_wksp(fseTable, norm, max, tableLog, (BYTE *)workspace + fseSize, workspaceSize - fseSize);
+		if (FSE_isError(errorCode))
+			return errorCode;
+	}
+
+	DTableH.fastMode = 1;
+	DTableH.tableLog = tableLog;
+	memcpy(dt, &DTableH, sizeof(DTableH));
+	for (u = 0; u < tableSize; u++) {
+		U32 const symbol = cell[u].symbol; /* <= max, by table construction */
+		dt[u + 1].nextState = cell[u].newState;
+		dt[u + 1].nbBits = cell[u].nbBits;
+		dt[u + 1].nbAdditionalBits = (BYTE)nbAdditionalBits[symbol];
+		dt[u + 1].baseValue = baseValue[symbol];
+	}
+	return 0;
+}
+
+/*! ZSTD_buildSeqSymbols_rle() :
+ *  table which always decodes the code with base value `baseValue` */
+static void ZSTD_buildSeqSymbols_rle(ZSTD_seqSymbol *dt, U32 baseValue, U32 nbAdditionalBits)
+{
+	ZSTD_seqSymbol_header DTableH;
+
+	DTableH.fastMode = 0;
+	DTableH.tableLog = 0;
+	memcpy(dt, &DTableH, sizeof(DTableH));
+	dt[1].nextState = 0;
+	dt[1].nbBits = 0;
+	dt[1].nbAdditionalBits = (BYTE)nbAdditionalBits;
+	dt[1].baseValue = baseValue;
+}
+
 /*! ZSTD_buildSeqTable() :
 	@return : nb bytes read from src,
 			  or an error code if it fails, testable with ZSTD_isError()
 */
-static size_t ZSTD_buildSeqTable(FSE_DTable *DTableSpace, const FSE_DTable **DTablePtr, symbolEncodingType_e type, U32 max, U32 maxLog, const void *src,
-				 size_t srcSize, const FSE_decode_t4 *defaultTable, U32 flagRepeatTable, void *workspace, size_t workspaceSize)
+static size_t ZSTD_buildSeqTable(ZSTD_seqSymbol *DTableSpace, const ZSTD_seqSymbol **DTablePtr, symbolEncodingType_e type, U32 max, U32 maxLog, const void *src,
+				 size_t srcSize, const U32 *baseValue, const U32 *nbAdditionalBits, const ZSTD_seqSymbol *defaultTable, U32 flagRepeatTable,
+				 void *workspace, size_t workspaceSize)
 {
-	const void *const tmpPtr = defaultTable; /* bypass strict aliasing */
 	switch (type) {
 	case set_rle:
 		if (!srcSize)
 			return ERROR(srcSize_wrong);
 		if ((*(const BYTE *)src) > max)
 			return ERROR(corruption_detected);
-		FSE_buildDTable_rle(DTableSpace, *(const BYTE *)src);
+		{
+			U32 const symbol = *(const BYTE *)src;
+			ZSTD_buildSeqSymbols_rle(DTableSpace, baseValue[symbol], nbAdditionalBits[symbol]);
+		}
 		*DTablePtr = DTableSpace;
 		return 1;
-	case set_basic: *DTablePtr = (const FSE_DTable *)tmpPtr; return 0;
+	case set_basic: *DTablePtr = defaultTable; return 0;
 	case set_repeat:
 		if (!flagRepeatTable)
 			return ERROR(corruption_detected);
@@ -783,7 +876,8 @@ static size_t ZSTD_buildSeqTable(FSE_DTable *DTableSpace, const FSE_DTable **DTa
 				return ERROR(corruption_detected);
 			if (tableLog > maxLog)
 				return ERROR(corruption_detected);
-			FSE_buildDTable_wksp(DTableSpace, norm, max, tableLog, workspace, workspaceSize);
+			if (ZSTD_isError(ZSTD_buildSeqSymbols(DTableSpace, norm, max, tableLog, baseValue, nbAdditionalBits, workspace, workspaceSize)))
+				return ERROR(corruption_detected);
 			*DTablePtr = DTableSpace;
 			return headerSize;
 		}
@@ -833,21 +927,21 @@ size_t ZSTD_decodeSeqHeaders(ZSTD_DCtx *dctx, int *nbSeqPtr, const void *src, si
 
 		/* Build DTables */
 		{
-			size_t const llhSize = ZSTD_buildSeqTable(dctx->entropy.LLTable, &dctx->LLTptr, LLtype, MaxLL, LLFSELog, ip, iend - ip,
+			size_t const llhSize = ZSTD_buildSeqTable(dctx->entropy.LLTable, &dctx->LLTptr, LLtype, MaxLL, LLFSELog, ip, iend - ip, LL_base, LL_bits,
 								  LL_defaultDTable, dctx->fseEntropy, dctx->entropy.workspace, sizeof(dctx->entropy.workspace));
 			if (ZSTD_isError(llhSize))
 				return ERROR(corruption_detected);
 			ip += llhSize;
 		}
 		{
-			size_t const ofhSize = ZSTD_buildSeqTable(dctx->entropy.OFTable, &dctx->OFTptr, OFtype, MaxOff, OffFSELog, ip, iend - ip,
+			size_t const ofhSize = ZSTD_buildSeqTable(dctx->entropy.OFTable, &dctx->OFTptr, OFtype, MaxOff, OffFSELog, ip, iend - ip, OF_base, OF_bits,
 								  OF_defaultDTable, dctx->fseEntropy, dctx->entropy.workspace, sizeof(dctx->entropy.workspace));
 			if (ZSTD_isError(ofhSize))
 				return ERROR(corruption_detected);
 			ip += ofhSize;
 		}
 		{
-			size_t const mlhSize = ZSTD_buildSeqTable(dctx->entropy.MLTable, &dctx->MLTptr, MLtype, MaxML, MLFSELog, ip, iend - ip,
+			size_t const mlhSize = ZSTD_buildSeqTable(dctx->entropy.MLTable, &dctx->MLTptr, MLtype, MaxML, MLFSELog, ip, iend - ip, ML_base, ML_bits,
 								  ML_defaultDTable, dctx->fseEntropy, dctx->entropy.workspace, sizeof(dctx->entropy.workspace));
 			if (ZSTD_isError(mlhSize))
 				return ERROR(corruption_detected);
@@ -865,17 +959,39 @@ typedef struct {
 	const BYTE *match;
 } seq_t;
 
+typedef struct {
+	size_t state;
+	const ZSTD_seqSymbol *table;
+} ZSTD_fseState;
+
 typedef struct {
 	BIT_DStream_t DStream;
-	FSE_DState_t stateLL;
-	FSE_DState_t stateOffb;
-	FSE_DState_t stateML;
+	ZSTD_fseState stateLL;
+	ZSTD_fseState stateOffb;
+	ZSTD_fseState stateML;
 	size_t prevOffset[ZSTD_REP_NUM];
 	const BYTE *base;
 	size_t pos;
 	uPtrDiff gotoDict;
 } seqState_t;
 
+static void ZSTD_initFseState(ZSTD_fseState *DStatePtr, BIT_DStream_t *bitD, const ZSTD_seqSymbol *dt)
+{
+	const void *ptr = dt;
+	const ZSTD_seqSymbol_header *const DTableH = (const ZSTD_seqSymbol_header *)ptr;
+	DStatePtr->state = BIT_readBits(bitD, DTableH->tableLog);
+	BIT_reloadDStream(bitD);
+	DStatePtr->table = dt + 1;
+}
+
+FORCE_INLINE void ZSTD_updateFseState(ZSTD_fseState *DStatePtr, BIT_DStream_t *bitD)
+{
+	ZSTD_seqSymbol const DInfo = DStatePtr->table[DStatePtr->state];
+	U32 const nbBits = DInfo.nbBits;
+	size_t const lowBits = BIT_readBits(bitD, nbBits);
+	DStatePtr->state = DInfo.nextState + lowBits;
+}
+
 FORCE_NOINLINE
 size_t ZSTD_execSequenceLast7(BYTE *op, BYTE *const oend, seq_t sequence, const BYTE **litPtr, const BYTE *const litLimit, const BYTE *const base,
 			      const BYTE *const vBase, const BYTE *const dictEnd)
@@ -932,39 +1048,31 @@ static seq_t ZSTD_decodeSequence(seqState_t *seqState)
 {
 	seq_t seq;
 
-	U32 const llCode = FSE_peekSymbol(&seqState->stateLL);
-	U32 const mlCode = FSE_peekSymbol(&seqState->stateML);
-	U32 const ofCode = FSE_peekSymbol(&seqState->stateOffb); /* <= maxOff, by table construction */
+	ZSTD_seqSymbol const llDInfo = seqState->stateLL.table[seqState->stateLL.state];
+	ZSTD_seqSymbol const mlDInfo = seqState->stateML.table[seqState->stateML.state];
+	ZSTD_seqSymbol const ofDInfo = seqState->stateOffb.table[seqState->stateOffb.state];
 
-	U32 const llBits = LL_bits[llCode];
-	U32 const mlBits = ML_bits[mlCode];
-	U32 const ofBits = ofCode;
+	U32 const llBase = llDInfo.baseValue;
+	U32 const mlBase = mlDInfo.baseValue;
+	U32 const ofBase = ofDInfo.baseValue;
+	U32 const llBits = llDInfo.nbAdditionalBits;
+	U32 const mlBits = mlDInfo.nbAdditionalBits;
+	U32 const ofBits = ofDInfo.nbAdditionalBits; /* == offset code */
 	U32 const totalBits = llBits + mlBits + ofBits;
 
-	static const U32 LL_base[MaxLL + 1] = {0,  1,  2,  3,  4,  5,  6,  7,  8,    9,     10,    11,    12,    13,     14,     15,     16,     18,
-					       20, 22, 24, 28, 32, 40, 48, 64, 0x80, 0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000, 0x8000, 0x10000};
-
-	static const U32 ML_base[MaxML + 1] = {3,  4,  5,  6,  7,  8,  9,  10,   11,    12,    13,    14,    15,     16,     17,     18,     19,     20,
-					       21, 22, 23, 24, 25, 26, 27, 28,   29,    30,    31,    32,    33,     34,     35,     37,     39,     41,
-					       43, 47, 51, 59, 67, 83, 99, 0x83, 0x103, 0x203, 0x403, 0x803, 0x1003, 0x2003, 0x4003, 0x8003, 0x10003};
-
-	static const U32 OF_base[MaxOff + 1] = {0,       1,	1,	5,	0xD,      0x1D,      0x3D,      0x7D,      0xFD,     0x1FD,
-						0x3FD,   0x7FD,    0xFFD,    0x1FFD,   0x3FFD,   0x7FFD,    0xFFFD,    0x1FFFD,   0x3FFFD,  0x7FFFD,
-						0xFFFFD, 0x1FFFFD, 0x3FFFFD, 0x7FFFFD, 0xFFFFFD, 0x1FFFFFD, 0x3FFFFFD, 0x7FFFFFD, 0xFFFFFFD};
-
 	/* sequence */
 	{
 		size_t offset;
-		if (!ofCode)
+		if (!ofBits)
 			offset = 0;
 		else {
-			offset = OF_base[ofCode] + BIT_readBitsFast(&seqState->DStream, ofBits); /* <=  (ZSTD_WINDOWLOG_MAX-1) bits */
+			offset = ofBase + BIT_readBitsFast(&seqState->DStream, ofBits); /* <=  (ZSTD_WINDOWLOG_MAX-1) bits */
 			if (ZSTD_32bits())
 				BIT_reloadDStream(&seqState->DStream);
 		}
 
-		if (ofCode <= 1) {
-			offset += (llCode == 0);
+		if (ofBits <= 1) {
+			offset += (llBase == 0); /* litLength code 0 */
 			if (offset) {
 				size_t temp = (offset == 3) ? seqState->prevOffset[0] - 1 : seqState->prevOffset[offset];
 				temp += !temp; /* 0 is not valid; input is corrupted; force offset to 1 */
@@ -983,20 +1091,20 @@ static seq_t ZSTD_decodeSequence(seqState_t *seqState)
 		seq.offset = offset;
 	}
 
-	seq.matchLength = ML_base[mlCode] + ((mlCode > 31) ? BIT_readBitsFast(&seqState->DStream, mlBits) : 0); /* <=  16 bits */
+	seq.matchLength = mlBase + (mlBits ? BIT_readBitsFast(&seqState->DStream, mlBits) : 0); /* <=  16 bits */
 	if (ZSTD_32bits() && (mlBits + llBits > 24))
 		BIT_reloadDStream(&seqState->DStream);
 
-	seq.litLength = LL_base[llCode] + ((llCode > 15) ? BIT_readBitsFast(&seqState->DStream, llBits) : 0); /* <=  16 bits */
+	seq.litLength = llBase + (llBits ? BIT_readBitsFast(&seqState->DStream, llBits) : 0); /* <=  16 bits */
 	if (ZSTD_32bits() || (totalBits > 64 - 7 - (LLFSELog + MLFSELog + OffFSELog)))
 		BIT_reloadDStream(&seqState->DStream);
 
 	/* ANS state update */
-	FSE_updateState(&seqState->stateLL, &seqState->DStream); /* <=  9 bits */
-	FSE_updateState(&seqState->stateML, &seqState->DStream); /* <=  9 bits */
+	ZSTD_updateFseState(&seqState->stateLL, &seqState->DStream); /* <=  9 bits */
+	ZSTD_updateFseState(&seqState->stateML, &seqState->DStream); /* <=  9 bits */
 	if (ZSTD_32bits())
 		BIT_reloadDStream(&seqState->DStream);		   /* <= 18 bits */
-	FSE_updateState(&seqState->stateOffb, &seqState->DStream); /* <=  8 bits */
+	ZSTD_updateFseState(&seqState->stateOffb, &seqState->DStream); /* <=  8 bits */
 
 	seq.match = NULL;
 
@@ -1023,10 +1131,15 @@ size_t ZSTD_execSequence(BYTE *op, BYTE *const oend, seq_t sequence, const BYTE
 		return ZSTD_execSequenceLast7(op, oend, sequence, litPtr, litLimit, base, vBase, dictEnd);
 
 	/* copy Literals */
-	ZSTD_copy8(op, *litPtr);
-	if (sequence.litLength > 8)
-		ZSTD_wildcopy(op + 8, (*litPtr) + 8,
-			      sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
+	if (oLitEnd <= oend - 16 && (size_t)(litLimit - iLitEnd) >= WILDCOPY_OVERLENGTH) {
+		/* 16 byte steps: the over-read stays within WILDCOPY_OVERLENGTH of litLimit */
+		ZSTD_wildcopy16(op, *litPtr, sequence.litLength);
+	} else {
+		ZSTD_copy8(op, *litPtr);
+		if (sequence.litLength > 8)
+			ZSTD_wildcopy(op + 8, (*litPtr) + 8,
+				      sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
+	}
 	op = oLitEnd;
 	*litPtr = iLitEnd; /* update for next sequence */
 
@@ -1057,6 +1170,12 @@ size_t ZSTD_execSequence(BYTE *op, BYTE *const oend, seq_t sequence, const BYTE
 	}
 	/* Requirement: op <= oend_w && sequence.matchLength >= MINMATCH */
 
+	/* far match, away from oend : no overlap within a 16 byte step */
+	if (sequence.offset >= 16 && oMatchEnd <= oend - 16) {
+		ZSTD_wildcopy16(op, match, oMatchEnd - op);
+		return sequenceLength;
+	}
+
 	/* match within prefix */
 	if (sequence.offset < 8) {
 		/* close range match, overlap */
@@ -1122,9 +1241,9 @@ static size_t ZSTD_decompressSequences(ZSTD_DCtx *dctx, void *dst, size_t maxDst
 				seqState.prevOffset[i] = dctx->entropy.rep[i];
 		}
 		CHECK_E(BIT_initDStream(&seqState.DStream, ip, iend - ip), corruption_detected);
-		FSE_initDState(&seqState.stateLL, &seqState.DStream, dctx->LLTptr);
-		FSE_initDState(&seqState.stateOffb, &seqState.DStream, dctx->OFTptr);
-		FSE_initDState(&seqState.stateML, &seqState.DStream, dctx->MLTptr);
+		ZSTD_initFseState(&seqState.stateLL, &seqState.DStream, dctx->LLTptr);
+		ZSTD_initFseState(&seqState.stateOffb, &seqState.DStream, dctx->OFTptr);
+		ZSTD_initFseState(&seqState.stateML, &seqState.DStream, dctx->MLTptr);
 
 		for (; (BIT_reloadDStream(&(seqState.DStream)) <= BIT_DStream_completed) && nbSeq;) {
 			nbSeq--;
@@ -1164,48 +1283,40 @@ FORCE_INLINE seq_t ZSTD_decodeSequenceLong_generic(seqState_t *seqState, int con
 {
 	seq_t seq;
 
-	U32 const llCode = FSE_peekSymbol(&seqState->stateLL);
-	U32 const mlCode = FSE_peekSymbol(&seqState->stateML);
-	U32 const ofCode = FSE_peekSymbol(&seqState->stateOffb); /* <= maxOff, by table construction */
+	ZSTD_seqSymbol const llDInfo = seqState->stateLL.table[seqState->stateLL.state];
+	ZSTD_seqSymbol const mlDInfo = seqState->stateML.table[seqState->stateML.state];
+	ZSTD_seqSymbol const ofDInfo = seqState->stateOffb.table[seqState->stateOffb.state];
 
-	U32 const llBits = LL_bits[llCode];
-	U32 const mlBits = ML_bits[mlCode];
-	U32 const ofBits = ofCode;
+	U32 const llBase = llDInfo.baseValue;
+	U32 const mlBase = mlDInfo.baseValue;
+	U32 const ofBase = ofDInfo.baseValue;
+	U32 const llBits = llDInfo.nbAdditionalBits;
+	U32 const mlBits = mlDInfo.nbAdditionalBits;
+	U32 const ofBits = ofDInfo.nbAdditionalBits; /* == offset code */
 	U32 const totalBits = llBits + mlBits + ofBits;
 
-	static const U32 LL_base[MaxLL + 1] = {0,  1,  2,  3,  4,  5,  6,  7,  8,    9,     10,    11,    12,    13,     14,     15,     16,     18,
-					       20, 22, 24, 28, 32, 40, 48, 64, 0x80, 0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000, 0x8000, 0x10000};
-
-	static const U32 ML_base[MaxML + 1] = {3,  4,  5,  6,  7,  8,  9,  10,   11,    12,    13,    14,    15,     16,     17,     18,     19,     20,
-					       21, 22, 23, 24, 25, 26, 27, 28,   29,    30,    31,    32,    33,     34,     35,     37,     39,     41,
-					       43, 47, 51, 59, 67, 83, 99, 0x83, 0x103, 0x203, 0x403, 0x803, 0x1003, 0x2003, 0x4003, 0x8003, 0x10003};
-
-	static const U32 OF_base[MaxOff + 1] = {0,       1,	1,	5,	0xD,      0x1D,      0x3D,      0x7D,      0xFD,     0x1FD,
-						0x3FD,   0x7FD,    0xFFD,    0x1FFD,   0x3FFD,   0x7FFD,    0xFFFD,    0x1FFFD,   0x3FFFD,  0x7FFFD,
-						0xFFFFD, 0x1FFFFD, 0x3FFFFD, 0x7FFFFD, 0xFFFFFD, 0x1FFFFFD, 0x3FFFFFD, 0x7FFFFFD, 0xFFFFFFD};
-
 	/* sequence */
 	{
 		size_t offset;
-		if (!ofCode)
+		if (!ofBits)
 			offset = 0;
 		else {
 			if (longOffsets) {
 				int const extraBits = ofBits - MIN(ofBits, STREAM_ACCUMULATOR_MIN);
-				offset = OF_base[ofCode] + (BIT_readBitsFast(&seqState->DStream, ofBits - extraBits) << extraBits);
+				offset = ofBase + (BIT_readBitsFast(&seqState->DStream, ofBits - extraBits) << extraBits);
 				if (ZSTD_32bits() || extraBits)
 					BIT_reloadDStream(&seqState->DStream);
 				if (extraBits)
 					offset += BIT_readBitsFast(&seqState->DStream, extraBits);
 			} else {
-				offset = OF_base[ofCode] + BIT_readBitsFast(&seqState->DStream, ofBits); /* <=  (ZSTD_WINDOWLOG_MAX-1) bits */
+				offset = ofBase + BIT_readBitsFast(&seqState->DStream, ofBits); /* <=  (ZSTD_WINDOWLOG_MAX-1) bits */
 				if (ZSTD_32bits())
 					BIT_reloadDStream(&seqState->DStream);
 			}
 		}
 
-		if (ofCode <= 1) {
-			offset += (llCode == 0);
+		if (ofBits <= 1) {
+			offset += (llBase == 0); /* litLength code 0 */
 			if (offset) {
 				size_t temp = (offset == 3) ? seqState->prevOffset[0] - 1 : seqState->prevOffset[offset];
 				temp += !temp; /* 0 is not valid; input is corrupted; force offset to 1 */
@@ -1224,11 +1335,11 @@ FORCE_INLINE seq_t ZSTD_decodeSequenceLong_generic(seqState_t *seqState, int con
 		seq.offset = offset;
 	}
 
-	seq.matchLength = ML_base[mlCode] + ((mlCode > 31) ? BIT_readBitsFast(&seqState->DStream, mlBits) : 0); /* <=  16 bits */
+	seq.matchLength = mlBase + (mlBits ? BIT_readBitsFast(&seqState->DStream, mlBits) : 0); /* <=  16 bits */
 	if (ZSTD_32bits() && (mlBits + llBits > 24))
 		BIT_reloadDStream(&seqState->DStream);
 
-	seq.litLength = LL_base[llCode] + ((llCode > 15) ? BIT_readBitsFast(&seqState->DStream, llBits) : 0); /* <=  16 bits */
+	seq.litLength = llBase + (llBits ? BIT_readBitsFast(&seqState->DStream, llBits) : 0); /* <=  16 bits */
 	if (ZSTD_32bits() || (totalBits > 64 - 7 - (LLFSELog + MLFSELog + OffFSELog)))
 		BIT_reloadDStream(&seqState->DStream);
 
@@ -1241,11 +1352,11 @@ FORCE_INLINE seq_t ZSTD_decodeSequenceLong_generic(seqState_t *seqState, int con
 	}
 
 	/* ANS state update */
-	FSE_updateState(&seqState->stateLL, &seqState->DStream); /* <=  9 bits */
-	FSE_updateState(&seqState->stateML, &seqState->DStream); /* <=  9 bits */
+	ZSTD_updateFseState(&seqState->stateLL, &seqState->DStream); /* <=  9 bits */
+	ZSTD_updateFseState(&seqState->stateML, &seqState->DStream); /* <=  9 bits */
 	if (ZSTD_32bits())
 		BIT_reloadDStream(&seqState->DStream);		   /* <= 18 bits */
-	FSE_updateState(&seqState->stateOffb, &seqState->DStream); /* <=  8 bits */
+	ZSTD_updateFseState(&seqState->stateOffb, &seqState->DStream); /* <=  8 bits */
 
 	return seq;
 }
@@ -1279,10 +1390,15 @@ size_t ZSTD_execSequenceLong(BYTE *op, BYTE *const oend, seq_t sequence, const B
 		return ZSTD_execSequenceLast7(op, oend, sequence, litPtr, litLimit, base, vBase, dictEnd);
 
 	/* copy Literals */
-	ZSTD_copy8(op, *litPtr);
-	if (sequence.litLength > 8)
-		ZSTD_wildcopy(op + 8, (*litPtr) + 8,
-			      sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
+	if (oLitEnd <= oend - 16 && (size_t)(litLimit - iLitEnd) >= WILDCOPY_OVERLENGTH) {
+		/* 16 byte steps: the over-read stays within WILDCOPY_OVERLENGTH of litLimit */
+		ZSTD_wildcopy16(op, *litPtr, sequence.litLength);
+	} else {
+		ZSTD_copy8(op, *litPtr);
+		if (sequence.litLength > 8)
+			ZSTD_wildcopy(op + 8, (*litPtr) + 8,
+				      sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
+	}
 	op = oLitEnd;
 	*litPtr = iLitEnd; /* update for next sequence */
 
@@ -1312,6 +1428,12 @@ size_t ZSTD_execSequenceLong(BYTE *op, BYTE *const oend, seq_t sequence, const B
 	}
 	/* Requirement: op <= oend_w && sequence.matchLength >= MINMATCH */
 
+	/* far match, away from oend : no overlap within a 16 byte step */
+	if (sequence.offset >= 16 && oMatchEnd <= oend - 16) {
+		ZSTD_wildcopy16(op, match, oMatchEnd - op);
+		return sequenceLength;
+	}
+
 	/* match within prefix */
 	if (sequence.offset < 8) {
 		/* close range match, overlap */
@@ -1388,9 +1510,9 @@ static size_t ZSTD_decompressSequencesLong(ZSTD_DCtx *dctx, void *dst, size_t ma
 		seqState.pos = (size_t)(op - base);
 		seqState.gotoDict = (uPtrDiff)dictEnd - (uPtrDiff)base; /* cast to avoid undefined behaviour */
 		CHECK_E(BIT_initDStream(&seqState.DStream, ip, iend - ip), corruption_detected);
-		FSE_initDState(&seqState.stateLL, &seqState.DStream, dctx->LLTptr);
-		FSE_initDState(&seqState.stateOffb, &seqState.DStream, dctx->OFTptr);
-		FSE_initDState(&seqState.stateML, &seqState.DStream, dctx->MLTptr);
+		ZSTD_initFseState(&seqState.stateLL, &seqState.DStream, dctx->LLTptr);
+		ZSTD_initFseState(&seqState.stateOffb, &seqState.DStream, dctx->OFTptr);
+		ZSTD_initFseState(&seqState.stateML, &seqState.DStream, dctx->MLTptr);
 
 		/* prepare in advance */
 		for (seqNb = 0; (BIT_reloadDStream(&seqState.DStream) <= BIT_DStream_completed) && seqNb < seqAdvance; seqNb++) {
@@ -1894,7 +2016,8 @@ static size_t ZSTD_loadEntropy(ZSTD_entropyTables_t *entropy, const void *const
 			return ERROR(dictionary_corrupted);
 		if (offcodeLog > OffFSELog)
 			return ERROR(dictionary_corrupted);
-		CHECK_E(FSE_buildDTable_wksp(entropy->OFTable, offcodeNCount, offcodeMaxValue, offcodeLog, entropy->workspace, sizeof(entropy->workspace)), dictionary_corrupted);
+		CHECK_E(ZSTD_buildSeqSymbols(entropy->OFTable, offcodeNCount, offcodeMaxValue, offcodeLog, OF_base, OF_bits, entropy->workspace, sizeof(entropy->workspace)),
+			dictionary_corrupted);
 		dictPtr += offcodeHeaderSize;
 	}
 
@@ -1906,7 +2029,8 @@ static size_t ZSTD_loadEntropy(ZSTD_entropyTables_t *entropy, const void *const
 			return ERROR(dictionary_corrupted);
 		if (matchlengthLog > MLFSELog)
 			return ERROR(dictionary_corrupted);
-		CHECK_E(FSE_buildDTable_wksp(entropy->MLTable, matchlengthNCount, matchlengthMaxValue, matchlengthLog, entropy->workspace, sizeof(entropy->workspace)), dictionary_corrupted);
+		CHECK_E(ZSTD_buildSeqSymbols(entropy->MLTable, matchlengthNCount, matchlengthMaxValue, matchlengthLog, ML_base, ML_bits, entropy->workspace, sizeof(entropy->workspace)),
+			dictionary_corrupted);
 		dictPtr += matchlengthHeaderSize;
 	}
 
@@ -1918,7 +2042,8 @@ static size_t ZSTD_loadEntropy(ZSTD_entropyTables_t *entropy, const void *const
 			return ERROR(dictionary_corrupted);
 		if (litlengthLog > LLFSELog)
 			return ERROR(dictionary_corrupted);
-		CHECK_E(FSE_buildDTable_wksp(entropy->LLTable, litlengthNCount, litlengthMaxValue, litlengthLog, entropy->workspace, sizeof(entropy->workspace)), dictionary_corrupted);
+		CHECK_E(ZSTD_buildSeqSymbols(entropy->LLTable, litlengthNCount, litlengthMaxValue, litlengthLog, LL_base, LL_bits, entropy->workspace, sizeof(entropy->workspace)),
+			dictionary_corrupted);
 		dictPtr += litlengthHeaderSize;
 	}
 
@@ -78,6 +78,38 @@ static DTableDesc HUF_getDTableDesc(const HUF_DTable *table)
 	return dtd;
 }
 
+/*-***************************/
+/*  4 streams fast loop      */
+/*-***************************/
+
+/* HUF_fastRounds() :
+ * Number of rounds of 4 symbols the 4 streams decoders can run on `bitD`,
+ * writing at most `maxOut` bytes per round into `outAvail` bytes, with only
+ * HUF_fastReload() in between. A round consumes at most 4 * HUF_TABLELOG_MAX
+ * bits, which together with the < 8 bits left over by the previous reload
+ * (8 right after BIT_initDStream()) moves the stream back by at most 7 bytes.
+ * Every reload in the batch then still finds a full bitContainer above start. */
+static size_t HUF_fastRounds(const BIT_DStream_t *bitD, size_t outAvail, size_t maxOut)
+{
+	size_t const inAvail = bitD->ptr - bitD->start;
+	size_t inRounds;
+
+	HUF_STATIC_ASSERT(4 * HUF_TABLELOG_MAX + 8 <= 56);
+	if (!ZSTD_64bits() || inAvail < sizeof(bitD->bitContainer))
+		return 0;
+	inRounds = (inAvail - sizeof(bitD->bitContainer)) / 7 + 1;
+	return min(inRounds, outAvail / maxOut);
+}
+
+/* HUF_fastReload() :
+ * BIT_reloadDStream() for the BIT_DStream_unfinished case HUF_fastRounds() guarantees */
+FORCE_INLINE void HUF_fastReload(BIT_DStream_t *bitD)
+{
+	bitD->ptr -= bitD->bitsConsumed >> 3;
+	bitD->bitsConsumed &= 7;
+	bitD->bitContainer = ZSTD_readLEST(bitD->ptr);
+}
+
 /*-***************************/
 /*  single-symbol decoding   */
 /*-***************************/
@@ -305,6 +337,39 @@ static size_t HUF_decompress4X2_usingDTable_internal(void *dst, size_t dstSize,
 				return errorCode;
 		}
 
+		/* Fast loop : bounds are checked once per batch of rounds instead of every round */
+		for (;;) {
+			size_t rounds = HUF_fastRounds(&bitD1, opStart2 - op1, 4);
+
+			rounds = min(rounds, HUF_fastRounds(&bitD2, opStart3 - op2, 4));
+			rounds = min(rounds, HUF_fastRounds(&bitD3, opStart4 - op3, 4));
+			rounds = min(rounds, HUF_fastRounds(&bitD4, oend - op4, 4));
+			if (!rounds)
+				break;
+			do {
+				HUF_DECODE_SYMBOLX2_0(op1, &bitD1);
+				HUF_DECODE_SYMBOLX2_0(op2, &bitD2);
+				HUF_DECODE_SYMBOLX2_0(op3, &bitD3);
+				HUF_DECODE_SYMBOLX2_0(op4, &bitD4);
+				HUF_DECODE_SYMBOLX2_0(op1, &bitD1);
+				HUF_DECODE_SYMBOLX2_0(op2, &bitD2);
+				HUF_DECODE_SYMBOLX2_0(op3, &bitD3);
+				HUF_DECODE_SYMBOLX2_0(op4, &bitD4);
+				HUF_DECODE_SYMBOLX2_0(op1, &bitD1);
+				HUF_DECODE_SYMBOLX2_0(op2, &bitD2);
+				HUF_DECODE_SYMBOLX2_0(op3, &bitD3);
+				HUF_DECODE_SYMBOLX2_0(op4, &bitD4);
+				HUF_DECODE_SYMBOLX2_0(op1, &bitD1);
+				HUF_DECODE_SYMBOLX2_0(op2, &bitD2);
+				HUF_DECODE_SYMBOLX2_0(op3, &bitD3);
+				HUF_DECODE_SYMBOLX2_0(op4, &bitD4);
+				HUF_fastReload(&bitD1);
+				HUF_fastReload(&bitD2);
+				HUF_fastReload(&bitD3);
+				HUF_fastReload(&bitD4);
+			} while (--rounds);
+		}
+
 		/* 16-32 symbols per loop (4-8 symbols per stream) */
 		endSignal = BIT_reloadDStream(&bitD1) | BIT_reloadDStream(&bitD2) | BIT_reloadDStream(&bitD3) | BIT_reloadDStream(&bitD4);
 		for (; (endSignal == BIT_DStream_unfinished) && (op4 < (oend - 7));) {
@@ -764,6 +829,39 @@ static size_t HUF_decompress4X4_usingDTable_internal(void *dst, size_t dstSize,
 				return errorCode;
 		}
 
+		/* Fast loop : bounds are checked once per batch of rounds instead of every round */
+		for (;;) {
+			size_t rounds = HUF_fastRounds(&bitD1, opStart2 - op1, 8);
+
+			rounds = min(rounds, HUF_fastRounds(&bitD2, opStart3 - op2, 8));
+			rounds = min(rounds, HUF_fastRounds(&bitD3, opStart4 - op3, 8));
+			rounds = min(rounds, HUF_fastRounds(&bitD4, oend - op4, 8));
+			if (!rounds)
+				break;
+			do {
+				HUF_DECODE_SYMBOLX4_0(op1, &bitD1);
+				HUF_DECODE_SYMBOLX4_0(op2, &bitD2);
+				HUF_DECODE_SYMBOLX4_0(op3, &bitD3);
+				HUF_DECODE_SYMBOLX4_0(op4, &bitD4);
+				HUF_DECODE_SYMBOLX4_0(op1, &bitD1);
+				HUF_DECODE_SYMBOLX4_0(op2, &bitD2);
+				HUF_DECODE_SYMBOLX4_0(op3, &bitD3);
+				HUF_DECODE_SYMBOLX4_0(op4, &bitD4);
+				HUF_DECODE_SYMBOLX4_0(op1, &bitD1);
+				HUF_DECODE_SYMBOLX4_0(op2, &bitD2);
+				HUF_DECODE_SYMBOLX4_0(op3, &bitD3);
+				HUF_DECODE_SYMBOLX4_0(op4, &bitD4);
+				HUF_DECODE_SYMBOLX4_0(op1, &bitD1);
+				HUF_DECODE_SYMBOLX4_0(op2, &bitD2);
+				HUF_DECODE_SYMBOLX4_0(op3, &bitD3);
+				HUF_DECODE_SYMBOLX4_0(op4, &bitD4);
+				HUF_fastReload(&bitD1);
+				HUF_fastReload(&bitD2);
+				HUF_fastReload(&bitD3);
+				HUF_fastReload(&bitD4);
+			} while (--rounds);
+		}
+
 		/* 16-32 symbols per loop (4-8 symbols per stream) */
 		endSignal = BIT_reloadDStream(&bitD1) | BIT_reloadDStream(&bitD2) | BIT_reloadDStream(&bitD3) | BIT_reloadDStream(&bitD4);
 		for (; (endSignal == BIT_DStream_unfinished) & (op4 < (oend - (sizeof(bitD4.bitContainer) - 1)));) {
@@ -0,0 +1,202 @@
+/*
+ * Job based parallel compression.
+ *
+ * The source is cut into jobs of jobSize bytes. Each job is compressed into
+ * an independent frame by one of nbWorkers workers, each owning its own
+ * ZSTD_CCtx and output buffer. Workers pull jobs in order from a shared
+ * counter and commit their frames to dst in job order, so the result is
+ * the concatenation of the frames a single threaded loop would produce.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation. This program is dual-licensed; you may select
+ * either version 2 of the GNU General Public License ("GPL") or BSD license
+ * ("BSD").
+ */
+
+/*-*************************************
+*  Dependencies
+***************************************/
+#include "zstd_internal.h" /* includes zstd.h */
+#include <linux/atomic.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h> /* memcpy */
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+/*-*************************************
+*  Context
+***************************************/
+typedef struct {
+	struct work_struct work;
+	ZSTD_MTCtx *mtctx;
+	ZSTD_CCtx *cctx;
+	BYTE *buffer; /* the job's frame, until it is its turn to go to dst */
+	size_t bufferSize;
+} ZSTD_MTWorker;
+
+struct ZSTD_MTCtx_s {
+	ZSTD_parameters params;
+	size_t jobSize;
+	unsigned nbWorkers;
+
+	/* state of the current ZSTD_compressMT() call */
+	const BYTE *src;
+	size_t srcSize;
+	BYTE *dst;
+	size_t dstCapacity;
+	size_t dstSize;	    /* protected by the commit order */
+	size_t error;	    /* first error, protected by the commit order */
+	unsigned nbJobs;
+	atomic_t nextJob;   /* next job to compress */
+	unsigned nbCommitted; /* jobs whose frames are in dst */
+	wait_queue_head_t commitWait;
+
+	ZSTD_MTWorker workers[];
+}; /* typedef'd to ZSTD_MTCtx within "zstd.h" */
+
+static size_t ZSTD_MTCtxSize(unsigned nbWorkers) { return ZSTD_ALIGN(sizeof(ZSTD_MTCtx) + nbWorkers * sizeof(ZSTD_MTWorker)); }
+
+size_t ZSTD_MTCtxWorkspaceBound(ZSTD_compressionParameters cParams, size_t jobSize, unsigned nbWorkers)
+{
+	size_t const workerSize = ZSTD_ALIGN(ZSTD_CCtxWorkspaceBound(cParams)) + ZSTD_ALIGN(ZSTD_compressBound(jobSize));
+	return ZSTD_MTCtxSize(nbWorkers) + nbWorkers * workerSize;
+}
+
+size_t ZSTD_compressMTBound(size_t srcSize, size_t jobSize)
+{
+	size_t const nbFullJobs = srcSize / jobSize;
+	size_t const lastJobSize = srcSize % jobSize;
+	size_t bound = nbFullJobs * ZSTD_compressBound(jobSize);
+
+	if (lastJobSize || !nbFullJobs)
+		bound += ZSTD_compressBound(lastJobSize);
+	return bound;
+}
+
+static void ZSTD_MT_work(struct work_struct *work);
+
+ZSTD_MTCtx *ZSTD_initMTCtx(ZSTD_parameters params, size_t jobSize, unsigned nbWorkers, void *workspace, size_t workspaceSize)
+{
+	size_t const cctxSize = ZSTD_ALIGN(ZSTD_CCtxWorkspaceBound(params.cParams));
+	size_t const bufferSize = ZSTD_ALIGN(ZSTD_compressBound(jobSize));
+	ZSTD_MTCtx *const mtctx = (ZSTD_MTCtx *)workspace;
+	BYTE *ptr = (BYTE *)workspace + ZSTD_MTCtxSize(nbWorkers);
+	unsigned w;
+
+	if (!workspace || workspace != ZSTD_PTR_ALIGN(workspace))
+		return NULL;
+	if (!jobSize || !nbWorkers || ZSTD_isError(ZSTD_checkCParams(params.cParams)))
+		return NULL;
+	if (workspaceSize < ZSTD_MTCtxWorkspaceBound(params.cParams, jobSize, nbWorkers))
+		return NULL;
+
+	memset(mtctx, 0, sizeof(*mtctx));
+	mtctx->params = params;
+	mtctx->jobSize = jobSize;
+	mtctx->nbWorkers = nbWorkers;
+	init_waitqueue_head(&mtctx->commitWait);
+
+	for (w = 0; w < nbWorkers; w++) {
+		ZSTD_MTWorker *const worker = &mtctx->workers[w];
+
+		INIT_WORK(&worker->work, ZSTD_MT_work);
+		worker->mtctx = mtctx;
+		worker->cctx = ZSTD_initCCtx(ptr, cctxSize);
+		if (!worker->cctx)
+			return NULL;
+		ptr += cctxSize;
+		worker->buffer = ptr;
+		worker->bufferSize = bufferSize;
+		ptr += bufferSize;
+	}
+	return mtctx;
+}
+
+/*-*************************************
+*  Compression
+***************************************/
+static void ZSTD_MT_commit(ZSTD_MTCtx *mtctx, const ZSTD_MTWorker *worker, size_t cSize)
+{
+	if (mtctx->error)
+		return;
+	if (ZSTD_isError(cSize)) {
+		mtctx->error = cSize;
+		return;
+	}
+	if (cSize > mtctx->dstCapacity - mtctx->dstSize) {
+		mtctx->error = ERROR(dstSize_tooSmall);
+		return;
+	}
+	memcpy(mtctx->dst + mtctx->dstSize, worker->buffer, cSize);
+	mtctx->dstSize += cSize;
+}
+
+static void ZSTD_MT_compressJobs(ZSTD_MTWorker *worker)
+{
+	ZSTD_MTCtx *const mtctx = worker->mtctx;
+
+	for (;;) {
+		unsigned const job = (unsigned)atomic_inc_return(&mtctx->nextJob) - 1;
+		size_t cSize = 0;
+
+		if (job >= mtctx->nbJobs)
+			return;
+
+		/* no point in compressing more once a job has failed */
+		if (!READ_ONCE(mtctx->error)) {
+			size_t const start = (size_t)job * mtctx->jobSize;
+			size_t const size = MIN(mtctx->jobSize, mtctx->srcSize - start);
+
+			cSize = ZSTD_compressCCtx(worker->cctx, worker->buffer, worker->bufferSize, mtctx->src + start, size, mtctx->params);
+		}
+
+		/*
+		 * Jobs are handed out in order, so every earlier job is owned by
+		 * a worker that is already running and waiting here can't deadlock.
+		 */
+		wait_event(mtctx->commitWait, smp_load_acquire(&mtctx->nbCommitted) == job);
+		ZSTD_MT_commit(mtctx, worker, cSize);
+		smp_store_release(&mtctx->nbCommitted, job + 1);
+		wake_up_all(&mtctx->commitWait);
+	}
+}
+
+static void ZSTD_MT_work(struct work_struct *work) { ZSTD_MT_compressJobs(container_of(work, ZSTD_MTWorker, work)); }
+
+size_t ZSTD_compressMT(ZSTD_MTCtx *mtctx, void *dst, size_t dstCapacity, const void *src, size_t srcSize)
+{
+	size_t const nbJobs = srcSize ? DIV_ROUND_UP(srcSize, mtctx->jobSize) : 1;
+	unsigned const nbWorkers = (unsigned)MIN(mtctx->nbWorkers, nbJobs);
+	unsigned w;
+
+	if (nbJobs > INT_MAX)
+		return ERROR(srcSize_wrong);
+
+	mtctx->src = (const BYTE *)src;
+	mtctx->srcSize = srcSize;
+	mtctx->dst = (BYTE *)dst;
+	mtctx->dstCapacity = dstCapacity;
+	mtctx->dstSize = 0;
+	mtctx->error = 0;
+	mtctx->nbJobs = (unsigned)nbJobs;
+	mtctx->nbCommitted = 0;
+	atomic_set(&mtctx->nextJob, 0);
+
+	/* The caller is worker 0, the others run on the unbound workqueue */
+	for (w = 1; w < nbWorkers; w++)
+		queue_work(system_unbound_wq, &mtctx->workers[w].work);
+	ZSTD_MT_compressJobs(&mtctx->workers[0]);
+	for (w = 1; w < nbWorkers; w++)
+		flush_work(&mtctx->workers[w].work);
+
+	if (mtctx->error)
+		return mtctx->error;
+	return mtctx->dstSize;
+}
+
+EXPORT_SYMBOL(ZSTD_MTCtxWorkspaceBound);
+EXPORT_SYMBOL(ZSTD_compressMTBound);
+EXPORT_SYMBOL(ZSTD_initMTCtx);
+EXPORT_SYMBOL(ZSTD_compressMT);
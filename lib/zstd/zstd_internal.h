@@ -151,6 +151,27 @@ ZSTD_STATIC void ZSTD_wildcopy(void *dst, const void *src, ptrdiff_t length)
 	} while (op < oend);
 }
 
+ZSTD_STATIC void ZSTD_copy16(void *dst, const void *src) {
+	memcpy(dst, src, 16);
+}
+/*! ZSTD_wildcopy16() :
+*   ZSTD_wildcopy() in 16 byte steps, can copy up to 15 bytes too many (16 bytes if length==0).
+*   Only for non overlapping copies, or overlapping ones where dst - src >= 16 */
+ZSTD_STATIC void ZSTD_wildcopy16(void *dst, const void *src, ptrdiff_t length)
+{
+	const BYTE* ip = (const BYTE*)src;
+	BYTE* op = (BYTE*)dst;
+	BYTE* const oend = op + length;
+	/* Same gcc bug 81388 workaround as ZSTD_wildcopy() */
+	if (length <= 16)
+		return ZSTD_copy16(dst, src);
+	do {
+		ZSTD_copy16(op, ip);
+		op += 16;
+		ip += 16;
+	} while (op < oend);
+}
+
 /*-*******************************************
 *  Private interfaces
 *********************************************/
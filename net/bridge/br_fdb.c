@@ -41,6 +41,7 @@ static int fdb_insert(struct net_bridge *br, struct net_bridge_port *source,
 		      const unsigned char *addr, u16 vid);
 static void fdb_notify(struct net_bridge *br,
 		       const struct net_bridge_fdb_entry *, int, bool);
+static unsigned long fdb_age_gran(const struct net_bridge *br);
 
 int __init br_fdb_init(void)
 {
@@ -61,6 +62,13 @@ void br_fdb_fini(void)
 
 int br_fdb_hash_init(struct net_bridge *br)
 {
+	int i;
+
+	for (i = 0; i < BR_FDB_AGE_SLOTS; i++)
+		INIT_HLIST_HEAD(&br->fdb_age_slots[i]);
+	br->fdb_age_gran = fdb_age_gran(br);
+	br->fdb_age_clock = jiffies;
+
 	return rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
 }
 
@@ -84,6 +92,30 @@ static inline int has_expired(const struct net_bridge *br,
 		time_before_eq(fdb->updated + hold_time(br), jiffies);
 }
 
+static unsigned long fdb_age_gran(const struct net_bridge *br)
+{
+	return max_t(unsigned long, hold_time(br) / BR_FDB_AGE_TICKS, 1);
+}
+
+/* Put an entry into the ageing wheel, requires bridge hash_lock.  The slot
+ * is the one that was current when the entry was last updated, so that it
+ * is scanned about when the entry expires, but never a slot that is already
+ * due.  Entries that don't age are looked at again a hold time from now.
+ */
+static void fdb_age_place(struct net_bridge *br,
+			  struct net_bridge_fdb_entry *f)
+{
+	unsigned long ticks = 0;
+	unsigned int slot;
+
+	if (!f->is_static && !f->added_by_external_learn)
+		ticks = min_t(unsigned long,
+			      (jiffies - f->updated) / br->fdb_age_gran,
+			      BR_FDB_AGE_TICKS - 1);
+	slot = (br->fdb_age_cursor - ticks) & (BR_FDB_AGE_SLOTS - 1);
+	hlist_add_head(&f->age_node, &br->fdb_age_slots[slot]);
+}
+
 static void fdb_rcu_free(struct rcu_head *head)
 {
 	struct net_bridge_fdb_entry *ent
@@ -206,6 +238,7 @@ static void fdb_delete(struct net_bridge *br, struct net_bridge_fdb_entry *f,
 		fdb_del_hw_addr(br, f->key.addr.addr);
 
 	hlist_del_init_rcu(&f->fdb_node);
+	hlist_del(&f->age_node);
 	rhashtable_remove_fast(&br->fdb_hash_tbl, &f->rhnode,
 			       br_fdb_rht_params);
 	fdb_notify(br, f, RTM_DELNEIGH, swdev_notify);
@@ -334,36 +367,81 @@ void br_fdb_change_mac_address(struct net_bridge *br, const u8 *newaddr)
 	spin_unlock_bh(&br->hash_lock);
 }
 
+/* The hold time changed, requires bridge hash_lock */
+static void fdb_age_rebuild(struct net_bridge *br)
+{
+	struct net_bridge_fdb_entry *f;
+
+	hlist_for_each_entry(f, &br->fdb_list, fdb_node) {
+		hlist_del(&f->age_node);
+		fdb_age_place(br, f);
+	}
+}
+
+/* Expire the entries of a slot that is due, requires bridge hash_lock.
+ * Entries that were refreshed since they were placed, which the learning
+ * fast path does without taking hash_lock, move on to a later slot.
+ */
+static void fdb_age_scan(struct net_bridge *br, unsigned int slot)
+{
+	struct net_bridge_fdb_entry *f;
+	struct hlist_node *tmp;
+	HLIST_HEAD(due);
+
+	hlist_move_list(&br->fdb_age_slots[slot], &due);
+	hlist_for_each_entry_safe(f, tmp, &due, age_node) {
+		if (has_expired(br, f)) {
+			fdb_delete(br, f, true);
+			continue;
+		}
+		hlist_del(&f->age_node);
+		fdb_age_place(br, f);
+	}
+}
+
 void br_fdb_cleanup(struct work_struct *work)
 {
 	struct net_bridge *br = container_of(work, struct net_bridge,
 					     gc_work.work);
-	struct net_bridge_fdb_entry *f = NULL;
-	unsigned long delay = hold_time(br);
-	unsigned long work_delay = delay;
+	unsigned long gran = fdb_age_gran(br);
+	u64 start = ktime_get_ns();
 	unsigned long now = jiffies;
+	unsigned long work_delay;
+	unsigned long ticks;
 
-	/* this part is tricky, in order to avoid blocking learning and
-	 * consequently forwarding, we rely on rcu to delete objects with
-	 * delayed freeing allowing us to continue traversing
-	 */
-	rcu_read_lock();
-	hlist_for_each_entry_rcu(f, &br->fdb_list, fdb_node) {
-		unsigned long this_timer;
+	spin_lock_bh(&br->hash_lock);
+	if (gran != br->fdb_age_gran) {
+		br->fdb_age_gran = gran;
+		br->fdb_age_clock = now;
+		fdb_age_rebuild(br);
+	}
+	ticks = (now - br->fdb_age_clock) / gran;
+	if (ticks > BR_FDB_AGE_SLOTS) {
+		/* one full turn looks at every entry */
+		br->fdb_age_clock += (ticks - BR_FDB_AGE_SLOTS) * gran;
+		ticks = BR_FDB_AGE_SLOTS;
+	}
+	spin_unlock_bh(&br->hash_lock);
 
-		if (f->is_static || f->added_by_external_learn)
-			continue;
-		this_timer = f->updated + delay;
-		if (time_after(this_timer, now)) {
-			work_delay = min(work_delay, this_timer - now);
-		} else {
-			spin_lock_bh(&br->hash_lock);
-			if (!hlist_unhashed(&f->fdb_node))
-				fdb_delete(br, f, true);
-			spin_unlock_bh(&br->hash_lock);
-		}
+	/* Only the slots that came due are scanned, and hash_lock is dropped
+	 * between them so that learning isn't held off for long.
+	 */
+	while (ticks--) {
+		spin_lock_bh(&br->hash_lock);
+		br->fdb_age_cursor++;
+		br->fdb_age_clock += gran;
+		fdb_age_scan(br, (br->fdb_age_cursor - BR_FDB_AGE_TICKS) &
+				 (BR_FDB_AGE_SLOTS - 1));
+		spin_unlock_bh(&br->hash_lock);
 	}
-	rcu_read_unlock();
+
+	WRITE_ONCE(br->fdb_age_work_ns,
+		   br->fdb_age_work_ns + ktime_get_ns() - start);
+
+	now = jiffies;
+	work_delay = 0;
+	if (time_after(br->fdb_age_clock + gran, now))
+		work_delay = br->fdb_age_clock + gran - now;
 
 	/* Cleanup minimum 10 milliseconds apart */
 	work_delay = max_t(unsigned long, work_delay, msecs_to_jiffies(10));
@@ -512,6 +590,7 @@ static struct net_bridge_fdb_entry *fdb_create(struct net_bridge *br,
 			fdb = NULL;
 		} else {
 			hlist_add_head_rcu(&fdb->fdb_node, &br->fdb_list);
+			fdb_age_place(br, fdb);
 		}
 	}
 	return fdb;
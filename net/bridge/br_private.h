@@ -28,6 +28,13 @@
 
 #define BR_HOLD_TIME (1*HZ)
 
+/* Dynamic FDB entries age through a wheel of slots, the wheel turning one
+ * slot per 1/BR_FDB_AGE_TICKS of the hold time.  A slot is scanned
+ * BR_FDB_AGE_TICKS turns after it was current.
+ */
+#define BR_FDB_AGE_SLOTS	256
+#define BR_FDB_AGE_TICKS	(BR_FDB_AGE_SLOTS / 2)
+
 #define BR_PORT_BITS	10
 #define BR_MAX_PORTS	(1<<BR_PORT_BITS)
 
@@ -188,6 +195,7 @@ struct net_bridge_fdb_entry {
 	/* write-heavy members should not affect lookups */
 	unsigned long			updated ____cacheline_aligned_in_smp;
 	unsigned long			used;
+	struct hlist_node		age_node;
 
 	struct rcu_head			rcu;
 };
@@ -416,6 +424,13 @@ struct net_bridge {
 	bool				neigh_suppress_enabled;
 	bool				mtu_set_by_user;
 	struct hlist_head		fdb_list;
+
+	/* FDB ageing wheel, protected by hash_lock */
+	struct hlist_head		fdb_age_slots[BR_FDB_AGE_SLOTS];
+	unsigned long			fdb_age_gran;
+	unsigned long			fdb_age_clock;
+	unsigned int			fdb_age_cursor;
+	u64				fdb_age_work_ns;
 };
 
 struct br_input_skb_cb {
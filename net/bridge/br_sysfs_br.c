@@ -268,6 +268,16 @@ static ssize_t gc_timer_show(struct device *d, struct device_attribute *attr,
 }
 static DEVICE_ATTR_RO(gc_timer);
 
+/* Total time spent ageing out FDB entries, in microseconds */
+static ssize_t gc_work_usecs_show(struct device *d,
+				  struct device_attribute *attr, char *buf)
+{
+	struct net_bridge *br = to_bridge(d);
+	return sprintf(buf, "%llu\n",
+		       div_u64(READ_ONCE(br->fdb_age_work_ns), NSEC_PER_USEC));
+}
+static DEVICE_ATTR_RO(gc_work_usecs);
+
 static ssize_t group_addr_show(struct device *d,
 			       struct device_attribute *attr, char *buf)
 {
@@ -821,6 +831,7 @@ static struct attribute *bridge_attrs[] = {
 	&dev_attr_tcn_timer.attr,
 	&dev_attr_topology_change_timer.attr,
 	&dev_attr_gc_timer.attr,
+	&dev_attr_gc_work_usecs.attr,
 	&dev_attr_group_addr.attr,
 	&dev_attr_flush.attr,
 #ifdef CONFIG_BRIDGE_IGMP_SNOOPING
@@ -48,6 +48,7 @@
 #include <linux/list.h>
 #include <linux/spinlock.h>
 #include <linux/rcupdate.h>
+#include <linux/hash.h>
 #include <linux/uaccess.h>
 #include <linux/net.h>
 #include <linux/netdevice.h>
@@ -353,11 +354,49 @@ static unsigned int effhash(canid_t can_id)
 	return hash & ((1 << CAN_EFF_RCV_HASH_BITS) - 1);
 }
 
+/*
+ * filhash - hash function for a masked CAN identifier of a can_id/mask filter
+ */
+static unsigned int filhash(canid_t can_id)
+{
+	return hash_32(can_id, CAN_FIL_RCV_HASH_BITS);
+}
+
+/*
+ * find_fil_list - find the hash bucket of a can_id/mask filter
+ *
+ * Filters are grouped by their mask, so that the receive path needs one
+ * hash lookup per distinct mask rather than a test per filter. A group for
+ * a mask that is not in use yet is only created from @spare.
+ */
+static struct hlist_head *find_fil_list(canid_t can_id, canid_t mask,
+					struct can_dev_rcv_lists *d,
+					struct can_rcv_mask **spare)
+{
+	struct can_rcv_mask *m;
+
+	hlist_for_each_entry(m, &d->rx_fil, list) {
+		if (m->mask == mask)
+			goto found;
+	}
+
+	m = *spare;
+	if (!m)
+		return NULL;
+
+	m->mask = mask;
+	hlist_add_head_rcu(&m->list, &d->rx_fil);
+found:
+	*spare = m;
+	return &m->rx[filhash(can_id)];
+}
+
 /**
  * find_rcv_list - determine optimal filterlist inside device filter struct
  * @can_id: pointer to CAN identifier of a given can_filter
  * @mask: pointer to CAN mask of a given can_filter
  * @d: pointer to the device filter struct
+ * @fil: in: unused mask group or NULL, out: mask group of the filterlist
  *
  * Description:
  *  Returns the optimal filterlist to reduce the filter handling in the
@@ -376,14 +415,19 @@ static unsigned int effhash(canid_t can_id)
  *  frames there is a special filterlist and a special rx path filter handling.
  *
  * Return:
- *  Pointer to optimal filterlist for the given can_id/mask pair.
+ *  Pointer to optimal filterlist for the given can_id/mask pair, NULL when
+ *  a new mask group would be needed but @fil provides none.
  *  Constistency checked mask.
  *  Reduced can_id to have a preprocessed filter compare value.
  */
 static struct hlist_head *find_rcv_list(canid_t *can_id, canid_t *mask,
-					struct can_dev_rcv_lists *d)
+					struct can_dev_rcv_lists *d,
+					struct can_rcv_mask **fil)
 {
 	canid_t inv = *can_id & CAN_INV_FILTER; /* save flag before masking */
+	struct can_rcv_mask *spare = *fil;
+
+	*fil = NULL;
 
 	/* filter for error message frames in extra filterlist */
 	if (*mask & CAN_ERR_FLAG) {
@@ -425,7 +469,8 @@ static struct hlist_head *find_rcv_list(canid_t *can_id, canid_t *mask,
 	}
 
 	/* default: filter via can_id/can_mask */
-	return &d->rx[RX_FIL];
+	*fil = spare;
+	return find_fil_list(*can_id, *mask, d, fil);
 }
 
 /**
@@ -465,7 +510,9 @@ int can_rx_register(struct net *net, struct net_device *dev, canid_t can_id,
 	struct receiver *r;
 	struct hlist_head *rl;
 	struct can_dev_rcv_lists *d;
+	struct can_rcv_mask *spare = NULL, *m;
 	struct s_pstats *can_pstats = net->can.can_pstats;
+	canid_t id, msk;
 	int err = 0;
 
 	/* insert new receiver  (dev,canid,mask) -> (func,data) */
@@ -480,14 +527,32 @@ int can_rx_register(struct net *net, struct net_device *dev, canid_t can_id,
 	if (!r)
 		return -ENOMEM;
 
+ retry:
 	spin_lock(&net->can.can_rcvlists_lock);
 
 	d = find_dev_rcv_lists(net, dev);
 	if (d) {
-		rl = find_rcv_list(&can_id, &mask, d);
+		id = can_id;
+		msk = mask;
+		m = spare;
+		rl = find_rcv_list(&id, &msk, d, &m);
+		if (!rl) {
+			/* first filter with this mask, get a group for it */
+			spin_unlock(&net->can.can_rcvlists_lock);
+			spare = kzalloc(sizeof(*spare), GFP_KERNEL);
+			if (spare)
+				goto retry;
+			kmem_cache_free(rcv_cache, r);
+			return -ENOMEM;
+		}
+		if (m) {
+			if (m == spare)
+				spare = NULL;
+			m->entries++;
+		}
 
-		r->can_id  = can_id;
-		r->mask    = mask;
+		r->can_id  = id;
+		r->mask    = msk;
 		r->matches = 0;
 		r->func    = func;
 		r->data    = data;
@@ -507,6 +572,7 @@ int can_rx_register(struct net *net, struct net_device *dev, canid_t can_id,
 
 	spin_unlock(&net->can.can_rcvlists_lock);
 
+	kfree(spare);
 	return err;
 }
 EXPORT_SYMBOL(can_rx_register);
@@ -543,6 +609,7 @@ void can_rx_unregister(struct net *net, struct net_device *dev, canid_t can_id,
 	struct hlist_head *rl;
 	struct s_pstats *can_pstats = net->can.can_pstats;
 	struct can_dev_rcv_lists *d;
+	struct can_rcv_mask *m = NULL;
 
 	if (dev && dev->type != ARPHRD_CAN)
 		return;
@@ -560,7 +627,7 @@ void can_rx_unregister(struct net *net, struct net_device *dev, canid_t can_id,
 		goto out;
 	}
 
-	rl = find_rcv_list(&can_id, &mask, d);
+	rl = find_rcv_list(&can_id, &mask, d, &m);
 
 	/*
 	 * Search the receiver list for the item to delete.  This should
@@ -568,10 +635,12 @@ void can_rx_unregister(struct net *net, struct net_device *dev, canid_t can_id,
 	 * been registered before.
 	 */
 
-	hlist_for_each_entry_rcu(r, rl, list) {
-		if (r->can_id == can_id && r->mask == mask &&
-		    r->func == func && r->data == data)
-			break;
+	if (rl) {
+		hlist_for_each_entry_rcu(r, rl, list) {
+			if (r->can_id == can_id && r->mask == mask &&
+			    r->func == func && r->data == data)
+				break;
+		}
 	}
 
 	/*
@@ -588,6 +657,12 @@ void can_rx_unregister(struct net *net, struct net_device *dev, canid_t can_id,
 	hlist_del_rcu(&r->list);
 	d->entries--;
 
+	/* drop the mask group with its last filter */
+	if (m && !--m->entries) {
+		hlist_del_rcu(&m->list);
+		kfree_rcu(m, rcu);
+	}
+
 	if (can_pstats->rcv_entries > 0)
 		can_pstats->rcv_entries--;
 
@@ -617,6 +692,7 @@ static inline void deliver(struct sk_buff *skb, struct receiver *r)
 
 static int can_rcv_filter(struct can_dev_rcv_lists *d, struct sk_buff *skb)
 {
+	struct can_rcv_mask *m;
 	struct receiver *r;
 	int matches = 0;
 	struct can_frame *cf = (struct can_frame *)skb->data;
@@ -642,11 +718,15 @@ static int can_rcv_filter(struct can_dev_rcv_lists *d, struct sk_buff *skb)
 		matches++;
 	}
 
-	/* check for can_id/mask entries */
-	hlist_for_each_entry_rcu(r, &d->rx[RX_FIL], list) {
-		if ((can_id & r->mask) == r->can_id) {
-			deliver(skb, r);
-			matches++;
+	/* check for can_id/mask entries, one lookup per distinct mask */
+	hlist_for_each_entry_rcu(m, &d->rx_fil, list) {
+		canid_t id = can_id & m->mask;
+
+		hlist_for_each_entry_rcu(r, &m->rx[filhash(id)], list) {
+			if (r->can_id == id) {
+				deliver(skb, r);
+				matches++;
+			}
 		}
 	}
 
@@ -63,14 +63,27 @@ struct receiver {
 #define CAN_SFF_RCV_ARRAY_SZ (1 << CAN_SFF_ID_BITS)
 #define CAN_EFF_RCV_HASH_BITS 10
 #define CAN_EFF_RCV_ARRAY_SZ (1 << CAN_EFF_RCV_HASH_BITS)
+#define CAN_FIL_RCV_HASH_BITS 8
+#define CAN_FIL_RCV_ARRAY_SZ (1 << CAN_FIL_RCV_HASH_BITS)
 
+/* RX_FIL receivers are not kept in rx[RX_FIL] but in rx_fil (see below) */
 enum { RX_ERR, RX_ALL, RX_FIL, RX_INV, RX_MAX };
 
+/* can_id/mask receivers sharing the same mask, hashed by masked can_id */
+struct can_rcv_mask {
+	struct hlist_node list;
+	canid_t mask;
+	int entries;
+	struct rcu_head rcu;
+	struct hlist_head rx[CAN_FIL_RCV_ARRAY_SZ];
+};
+
 /* per device receive filters linked at dev->ml_priv */
 struct can_dev_rcv_lists {
 	struct hlist_head rx[RX_MAX];
 	struct hlist_head rx_sff[CAN_SFF_RCV_ARRAY_SZ];
 	struct hlist_head rx_eff[CAN_EFF_RCV_ARRAY_SZ];
+	struct hlist_head rx_fil; /* struct can_rcv_mask, one per mask */
 	int remove_on_zero_entries;
 	int entries;
 };
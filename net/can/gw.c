@@ -51,6 +51,9 @@
 #include <linux/netdevice.h>
 #include <linux/if_arp.h>
 #include <linux/skbuff.h>
+#include <linux/bpf.h>
+#include <linux/filter.h>
+#include <linux/pkt_cls.h>
 #include <linux/can.h>
 #include <linux/can/core.h>
 #include <linux/can/skb.h>
@@ -109,6 +112,9 @@ struct cf_mod {
 		void (*crc8)(struct can_frame *cf, struct cgw_csum_crc8 *crc8);
 	} csumfunc;
 	u32 uid;
+
+	/* BPF program run after the modifications above */
+	struct bpf_prog __rcu *prog;
 };
 
 
@@ -344,10 +350,116 @@ static void cgw_csum_crc8_neg(struct can_frame *cf, struct cgw_csum_crc8 *crc8)
 	cf->data[crc8->result_idx] = crc^crc8->final_xor_val;
 }
 
+#ifdef CONFIG_CAN_GW_BPF
+/*
+ * Run the BPF program of a job on its private copy of the CAN frame. The
+ * program may rewrite the frame in place and may route it to another CAN
+ * interface with bpf_redirect(). Returns non-zero if the frame is dropped.
+ */
+static int cgw_run_prog(struct cgw_job *gwj, struct bpf_prog *prog,
+			struct sk_buff *skb)
+{
+	struct bpf_redirect_info *ri;
+	unsigned int len = skb->len;
+	struct net_device *dev;
+	int act;
+
+	bpf_compute_data_pointers(skb);
+	act = BPF_PROG_RUN(prog, skb);
+
+	/* the program must leave a CAN frame of the same size behind */
+	if (skb->len != len || skb_headlen(skb) != len)
+		return -EINVAL;
+
+	switch (act) {
+	case TC_ACT_UNSPEC:	/* no verdict, as in tc */
+	case TC_ACT_OK:
+		return 0;
+	case TC_ACT_REDIRECT:
+		ri = this_cpu_ptr(&bpf_redirect_info);
+		dev = dev_get_by_index_rcu(dev_net(skb->dev), ri->ifindex);
+		ri->ifindex = 0;
+		/* CAN frames can only be sent, not injected as received */
+		if (ri->flags & BPF_F_INGRESS)
+			return -EOPNOTSUPP;
+		if (!dev || dev->type != ARPHRD_CAN || !(dev->flags & IFF_UP))
+			return -ENODEV;
+		if (!(gwj->flags & CGW_FLAGS_CAN_IIF_TX_OK) &&
+		    can_skb_prv(skb)->ifindex == dev->ifindex)
+			return -ELOOP;
+		skb->dev = dev;
+		return 0;
+	default:
+		return -EPERM;
+	}
+}
+
+/*
+ * Of the tc helpers a gateway program may only use the ones that access the
+ * frame and bpf_redirect(). Others, like bpf_clone_redirect(), would send
+ * the frame out without the checks in cgw_run_prog().
+ */
+static const enum bpf_func_id cgw_bpf_funcs[] = {
+	BPF_FUNC_skb_load_bytes,
+	BPF_FUNC_skb_store_bytes,
+	BPF_FUNC_skb_pull_data,	/* emitted by the prologue for direct writes */
+	BPF_FUNC_redirect,
+};
+
+static bool cgw_bpf_func_ok(const struct bpf_prog *prog, s32 imm)
+{
+	const struct bpf_func_proto *fn;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cgw_bpf_funcs); i++) {
+		fn = tc_cls_act_verifier_ops.get_func_proto(cgw_bpf_funcs[i],
+							     prog);
+		if (fn && fn->func - __bpf_call_base == imm)
+			return true;
+	}
+
+	return false;
+}
+
+/* check the helper calls in the verified program against cgw_bpf_funcs */
+static int cgw_check_prog(const struct bpf_prog *prog)
+{
+	const struct bpf_insn *insn = prog->insnsi;
+	u32 i;
+
+	for (i = 0; i < prog->len; i++, insn++) {
+		if (BPF_CLASS(insn->code) != BPF_JMP)
+			continue;
+
+		if (BPF_OP(insn->code) == BPF_TAIL_CALL)
+			return -EPERM;
+
+		if (BPF_OP(insn->code) == BPF_CALL &&
+		    insn->src_reg != BPF_PSEUDO_CALL &&
+		    !cgw_bpf_func_ok(prog, insn->imm))
+			return -EPERM;
+	}
+
+	return 0;
+}
+#else
+static int cgw_run_prog(struct cgw_job *gwj, struct bpf_prog *prog,
+			struct sk_buff *skb)
+{
+	return -EOPNOTSUPP;
+}
+
+static int cgw_check_prog(const struct bpf_prog *prog)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
 /* the receive & process & send function */
 static void can_can_gw_rcv(struct sk_buff *skb, void *data)
 {
 	struct cgw_job *gwj = (struct cgw_job *)data;
+	struct bpf_prog *prog;
 	struct can_frame *cf;
 	struct sk_buff *nskb;
 	int modidx = 0;
@@ -389,8 +501,11 @@ static void can_can_gw_rcv(struct sk_buff *skb, void *data)
 	 *
 	 * When there is at least one modification function activated,
 	 * we need to copy the skb as we want to modify skb->data.
+	 * A CGW_MOD_UID update may replace the program meanwhile, so it
+	 * is read only once.
 	 */
-	if (gwj->mod.modfunc[0])
+	prog = rcu_dereference(gwj->mod.prog);
+	if (gwj->mod.modfunc[0] || prog)
 		nskb = skb_copy(skb, GFP_ATOMIC);
 	else
 		nskb = skb_clone(skb, GFP_ATOMIC);
@@ -416,8 +531,18 @@ static void can_can_gw_rcv(struct sk_buff *skb, void *data)
 	while (modidx < MAX_MODFUNCTIONS && gwj->mod.modfunc[modidx])
 		(*gwj->mod.modfunc[modidx++])(cf, &gwj->mod);
 
+	/* let the BPF program rewrite the frame and pick its destination */
+	if (prog) {
+		if (cgw_run_prog(gwj, prog, nskb)) {
+			kfree_skb(nskb);
+			gwj->dropped_frames++;
+			return;
+		}
+		cf = (struct can_frame *)nskb->data;
+	}
+
 	/* check for checksum updates when the CAN frame has been modified */
-	if (modidx) {
+	if (modidx || prog) {
 		if (gwj->mod.csumfunc.crc8)
 			(*gwj->mod.csumfunc.crc8)(cf, &gwj->mod.csum.crc8);
 
@@ -436,6 +561,20 @@ static void can_can_gw_rcv(struct sk_buff *skb, void *data)
 		gwj->handled_frames++;
 }
 
+static void cgw_put_mod(struct cf_mod *mod)
+{
+	struct bpf_prog *prog = rcu_dereference_protected(mod->prog, 1);
+
+	if (prog)
+		bpf_prog_put(prog);
+}
+
+static void cgw_job_free(struct cgw_job *gwj)
+{
+	cgw_put_mod(&gwj->mod);
+	kmem_cache_free(cgw_cache, gwj);
+}
+
 static inline int cgw_register_filter(struct net *net, struct cgw_job *gwj)
 {
 	return can_rx_register(net, gwj->src.dev, gwj->ccgw.filter.can_id,
@@ -470,7 +609,7 @@ static int cgw_notifier(struct notifier_block *nb,
 			if (gwj->src.dev == dev || gwj->dst.dev == dev) {
 				hlist_del(&gwj->list);
 				cgw_unregister_filter(net, gwj);
-				kmem_cache_free(cgw_cache, gwj);
+				cgw_job_free(gwj);
 			}
 		}
 	}
@@ -483,6 +622,7 @@ static int cgw_put_job(struct sk_buff *skb, struct cgw_job *gwj, int type,
 {
 	struct cgw_frame_mod mb;
 	struct rtcanmsg *rtcan;
+	struct bpf_prog *prog;
 	struct nlmsghdr *nlh;
 
 	nlh = nlmsg_put(skb, pid, seq, type, sizeof(*rtcan), flags);
@@ -551,6 +691,12 @@ static int cgw_put_job(struct sk_buff *skb, struct cgw_job *gwj, int type,
 			goto cancel;
 	}
 
+	prog = rcu_dereference_rtnl(gwj->mod.prog);
+	if (prog) {
+		if (nla_put_u32(skb, CGW_BPF_ID, prog->aux->id) < 0)
+			goto cancel;
+	}
+
 	if (gwj->mod.csumfunc.crc8) {
 		if (nla_put(skb, CGW_CS_CRC8, CGW_CS_CRC8_LEN,
 			    &gwj->mod.csum.crc8) < 0)
@@ -624,6 +770,7 @@ static const struct nla_policy cgw_policy[CGW_MAX+1] = {
 	[CGW_FILTER]	= { .len = sizeof(struct can_filter) },
 	[CGW_LIM_HOPS]	= { .type = NLA_U8 },
 	[CGW_MOD_UID]	= { .type = NLA_U32 },
+	[CGW_BPF_FD]	= { .type = NLA_U32 },
 };
 
 /* check for common and gwtype specific attributes */
@@ -717,7 +864,7 @@ static int cgw_parse_attr(struct nlmsghdr *nlh, struct cf_mod *mod,
 	}
 
 	/* check for checksum operations after CAN frame modifications */
-	if (modidx) {
+	if (modidx || tb[CGW_BPF_FD]) {
 
 		if (tb[CGW_CS_CRC8]) {
 			struct cgw_csum_crc8 *c = nla_data(tb[CGW_CS_CRC8]);
@@ -804,6 +951,24 @@ static int cgw_parse_attr(struct nlmsghdr *nlh, struct cf_mod *mod,
 
 	/* add the checks for other gwtypes here */
 
+	/* take the program reference last, nothing can fail after it */
+	if (tb[CGW_BPF_FD]) {
+		struct bpf_prog *prog;
+
+		prog = bpf_prog_get_type(nla_get_u32(tb[CGW_BPF_FD]),
+					 BPF_PROG_TYPE_SCHED_CLS);
+		if (IS_ERR(prog))
+			return PTR_ERR(prog);
+
+		err = cgw_check_prog(prog);
+		if (err < 0) {
+			bpf_prog_put(prog);
+			return err;
+		}
+
+		RCU_INIT_POINTER(mod->prog, prog);
+	}
+
 	return 0;
 }
 
@@ -811,6 +976,7 @@ static int cgw_create_job(struct sk_buff *skb,  struct nlmsghdr *nlh,
 			  struct netlink_ext_ack *extack)
 {
 	struct net *net = sock_net(skb->sk);
+	struct bpf_prog *prog;
 	struct rtcanmsg *r;
 	struct cgw_job *gwj;
 	struct cf_mod mod;
@@ -847,24 +1013,41 @@ static int cgw_create_job(struct sk_buff *skb,  struct nlmsghdr *nlh,
 				continue;
 
 			/* interfaces & filters must be identical */
-			if (memcmp(&gwj->ccgw, &ccgw, sizeof(ccgw)))
+			if (memcmp(&gwj->ccgw, &ccgw, sizeof(ccgw))) {
+				cgw_put_mod(&mod);
 				return -EINVAL;
+			}
 
-			/* update modifications with disabled softirq & quit */
+			/*
+			 * update modifications with disabled softirq & quit,
+			 * the program is published separately because other
+			 * CPUs may be running it in can_can_gw_rcv()
+			 */
+			prog = rcu_dereference_protected(mod.prog, 1);
+			RCU_INIT_POINTER(mod.prog,
+					 rtnl_dereference(gwj->mod.prog));
 			local_bh_disable();
-			memcpy(&gwj->mod, &mod, sizeof(mod));
+			swap(gwj->mod, mod);
+			rcu_assign_pointer(gwj->mod.prog, prog);
 			local_bh_enable();
+
+			/* the old program is freed after an RCU grace period */
+			cgw_put_mod(&mod);
 			return 0;
 		}
 	}
 
 	/* ifindex == 0 is not allowed for job creation */
-	if (!ccgw.src_idx || !ccgw.dst_idx)
+	if (!ccgw.src_idx || !ccgw.dst_idx) {
+		cgw_put_mod(&mod);
 		return -ENODEV;
+	}
 
 	gwj = kmem_cache_alloc(cgw_cache, GFP_KERNEL);
-	if (!gwj)
+	if (!gwj) {
+		cgw_put_mod(&mod);
 		return -ENOMEM;
+	}
 
 	gwj->handled_frames = 0;
 	gwj->dropped_frames = 0;
@@ -902,7 +1085,7 @@ static int cgw_create_job(struct sk_buff *skb,  struct nlmsghdr *nlh,
 		hlist_add_head_rcu(&gwj->list, &net->can.cgw_list);
 out:
 	if (err)
-		kmem_cache_free(cgw_cache, gwj);
+		cgw_job_free(gwj);
 
 	return err;
 }
@@ -917,7 +1100,7 @@ static void cgw_remove_all_jobs(struct net *net)
 	hlist_for_each_entry_safe(gwj, nx, &net->can.cgw_list, list) {
 		hlist_del(&gwj->list);
 		cgw_unregister_filter(net, gwj);
-		kmem_cache_free(cgw_cache, gwj);
+		cgw_job_free(gwj);
 	}
 }
 
@@ -954,6 +1137,7 @@ static int cgw_remove_job(struct sk_buff *skb, struct nlmsghdr *nlh,
 	/* two interface indices both set to 0 => remove all entries */
 	if (!ccgw.src_idx && !ccgw.dst_idx) {
 		cgw_remove_all_jobs(net);
+		cgw_put_mod(&mod);
 		return 0;
 	}
 
@@ -986,11 +1170,12 @@ static int cgw_remove_job(struct sk_buff *skb, struct nlmsghdr *nlh,
 
 		hlist_del(&gwj->list);
 		cgw_unregister_filter(net, gwj);
-		kmem_cache_free(cgw_cache, gwj);
+		cgw_job_free(gwj);
 		err = 0;
 		break;
 	}
 
+	cgw_put_mod(&mod);
 	return err;
 }
 
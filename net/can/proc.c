@@ -297,11 +297,32 @@ static int can_version_proc_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+static void can_rcvlist_proc_show_fil(struct seq_file *m,
+				      struct net_device *dev,
+				      struct can_dev_rcv_lists *d)
+{
+	struct can_rcv_mask *fil;
+	unsigned int i;
+
+	if (hlist_empty(&d->rx_fil)) {
+		seq_printf(m, "  (%s: no entry)\n", DNAME(dev));
+		return;
+	}
+
+	can_print_recv_banner(m);
+	hlist_for_each_entry_rcu(fil, &d->rx_fil, list) {
+		for (i = 0; i < ARRAY_SIZE(fil->rx); i++)
+			can_print_rcvlist(m, &fil->rx[i], dev);
+	}
+}
+
 static inline void can_rcvlist_proc_show_one(struct seq_file *m, int idx,
 					     struct net_device *dev,
 					     struct can_dev_rcv_lists *d)
 {
-	if (!hlist_empty(&d->rx[idx])) {
+	if (idx == RX_FIL) {
+		can_rcvlist_proc_show_fil(m, dev, d);
+	} else if (!hlist_empty(&d->rx[idx])) {
 		can_print_recv_banner(m);
 		can_print_rcvlist(m, &d->rx[idx], dev);
 	} else
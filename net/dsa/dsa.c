@@ -191,7 +191,8 @@ static int dsa_switch_rcv(struct sk_buff *skb, struct net_device *dev,
 	if (dsa_skb_defer_rx_timestamp(p, skb))
 		return 0;
 
-	netif_receive_skb(skb);
+	/* The tag is gone by now, so flows aggregate per slave port */
+	gro_cells_receive(&p->gcells, skb);
 
 	return 0;
 }
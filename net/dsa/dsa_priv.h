@@ -15,6 +15,7 @@
 #include <linux/netdevice.h>
 #include <linux/netpoll.h>
 #include <net/dsa.h>
+#include <net/gro_cells.h>
 
 enum {
 	DSA_NOTIFIER_AGEING_TIME,
@@ -65,12 +66,25 @@ struct dsa_notifier_vlan_info {
 	int port;
 };
 
+/* Tagged frames held back while the stack has more to send */
+#define DSA_SLAVE_XMIT_BATCH	64
+
+struct dsa_slave_xmit_batch {
+	struct sk_buff		*head;
+	struct sk_buff		*tail;
+	unsigned int		len;
+	u16			queue;
+};
+
 struct dsa_slave_priv {
 	/* Copy of CPU port xmit for faster access in slave transmit hot path */
 	struct sk_buff *	(*xmit)(struct sk_buff *skb,
 					struct net_device *dev);
 
 	struct pcpu_sw_netstats	*stats64;
+	struct dsa_slave_xmit_batch __percpu *xmit_batch;
+
+	struct gro_cells	gcells;
 
 	/* DSA port data, such as switch, port index, etc. */
 	struct dsa_port		*dp;
@@ -18,7 +18,10 @@
 #include <linux/of_mdio.h>
 #include <linux/mdio.h>
 #include <net/rtnetlink.h>
+#include <net/netprio_cgroup.h>
+#include <net/sock.h>
 #include <net/pkt_cls.h>
+#include <net/sch_generic.h>
 #include <net/tc_act/tc_mirred.h>
 #include <linux/if_bridge.h>
 #include <linux/netpoll.h>
@@ -422,11 +425,129 @@ static void dsa_skb_tx_timestamp(struct dsa_slave_priv *p,
 	kfree_skb(clone);
 }
 
+/* Hand the held back frames to the master in one go, so that its driver
+ * sees xmit_more on all but the last of them.
+ */
+static void dsa_slave_xmit_flush(struct dsa_slave_xmit_batch *b,
+				 struct net_device *master)
+{
+	struct sk_buff *skb = b->head, *next;
+	struct netdev_queue *txq;
+	unsigned int left = 0;
+	int cpu, ret;
+
+	if (!skb)
+		return;
+	b->head = NULL;
+	b->tail = NULL;
+	b->len = 0;
+
+	cpu = smp_processor_id();
+	txq = netdev_get_tx_queue(master, b->queue);
+	if (likely((master->flags & IFF_UP) && txq->xmit_lock_owner != cpu)) {
+		HARD_TX_LOCK(master, txq, cpu);
+		while (skb && !netif_xmit_stopped(txq)) {
+			next = skb->next;
+			skb->next = NULL;
+			ret = netdev_start_xmit(skb, master, txq, next != NULL);
+			if (unlikely(!dev_xmit_complete(ret))) {
+				skb->next = next;
+				break;
+			}
+			skb = next;
+		}
+		HARD_TX_UNLOCK(master, txq);
+	}
+
+	if (likely(!skb))
+		return;
+
+	for (next = skb; next; next = next->next)
+		left++;
+	atomic_long_add(left, &master->tx_dropped);
+	kfree_skb_list(skb);
+}
+
+/* The master's net_prio map applies as it would in __dev_queue_xmit() */
+static void dsa_slave_update_prio(struct net_device *master,
+				  struct sk_buff *skb)
+{
+#if IS_ENABLED(CONFIG_CGROUP_NET_PRIO)
+	const struct netprio_map *map;
+	unsigned int prioidx;
+
+	map = rcu_dereference_bh(master->priomap);
+	if (!map || skb->priority || !skb->sk)
+		return;
+
+	prioidx = sock_cgroup_prioidx(&skb->sk->sk_cgrp_data);
+	if (prioidx < map->priomap_len)
+		skb->priority = map->priomap[prioidx];
+#endif
+}
+
+/* Whether the master has anything that must see each frame on the way out:
+ * a qdisc, tc egress filters or packet taps.
+ */
+static bool dsa_slave_master_hooked(struct net_device *master,
+				    struct netdev_queue *txq)
+{
+#ifdef CONFIG_NET_CLS_ACT
+	if (rcu_access_pointer(master->miniq_egress))
+		return true;
+#endif
+	return rcu_dereference_bh(txq->qdisc)->enqueue ||
+	       !list_empty(&master->ptype_all);
+}
+
+/* A master without a qdisc gets the tagged frames of one xmit_more burst,
+ * typically the segments of a GSO packet, as a single batch. Masters keep
+ * their default qdisc unless it is replaced with noqueue, and until then
+ * every frame goes through dev_queue_xmit() as before.
+ */
+static void dsa_slave_xmit_queue(struct dsa_slave_priv *p,
+				 struct net_device *master,
+				 struct sk_buff *skb, bool more)
+{
+	struct dsa_slave_xmit_batch *b = this_cpu_ptr(p->xmit_batch);
+	struct netdev_queue *txq;
+	bool again = false;
+
+	skb_reset_mac_header(skb);
+	dsa_slave_update_prio(master, skb);
+	txq = netdev_pick_tx(master, skb, NULL);
+	if (b->head && b->queue != skb_get_queue_mapping(skb))
+		dsa_slave_xmit_flush(b, master);
+
+	if (dsa_slave_master_hooked(master, txq)) {
+		dsa_slave_xmit_flush(b, master);
+		dev_queue_xmit(skb);
+		return;
+	}
+
+	skb = validate_xmit_skb_list(skb, master, &again);
+	if (skb) {
+		if (b->head)
+			b->tail->next = skb;
+		else
+			b->head = skb;
+		b->queue = skb_get_queue_mapping(skb);
+		for (b->len++; skb->next; b->len++)
+			skb = skb->next;
+		b->tail = skb;
+	}
+
+	if (!more || b->len >= DSA_SLAVE_XMIT_BATCH)
+		dsa_slave_xmit_flush(b, master);
+}
+
 static netdev_tx_t dsa_slave_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	struct dsa_slave_priv *p = netdev_priv(dev);
+	bool more = skb->xmit_more;
 	struct pcpu_sw_netstats *s;
 	struct sk_buff *nskb;
+	netdev_tx_t ret;
 
 	s = this_cpu_ptr(p->stats64);
 	u64_stats_update_begin(&s->syncp);
@@ -445,22 +566,32 @@ static netdev_tx_t dsa_slave_xmit(struct sk_buff *skb, struct net_device *dev)
 	nskb = p->xmit(skb, dev);
 	if (!nskb) {
 		kfree_skb(skb);
-		return NETDEV_TX_OK;
+		ret = NETDEV_TX_OK;
+		goto out;
 	}
 
 	/* SKB for netpoll still need to be mangled with the protocol-specific
 	 * tag to be successfully transmitted
 	 */
-	if (unlikely(netpoll_tx_running(dev)))
-		return dsa_slave_netpoll_send_skb(dev, nskb);
+	if (unlikely(netpoll_tx_running(dev))) {
+		ret = dsa_slave_netpoll_send_skb(dev, nskb);
+		goto out;
+	}
 
 	/* Queue the SKB for transmission on the parent interface, but
 	 * do not modify its EtherType
 	 */
 	nskb->dev = dsa_slave_to_master(dev);
-	dev_queue_xmit(nskb);
+	dsa_slave_xmit_queue(p, nskb->dev, nskb, more);
 
 	return NETDEV_TX_OK;
+
+out:
+	/* the end of a burst must not leave earlier frames held back */
+	if (!more)
+		dsa_slave_xmit_flush(this_cpu_ptr(p->xmit_batch),
+				     dsa_slave_to_master(dev));
+	return ret;
 }
 
 /* ethtool operations *******************************************************/
@@ -1331,6 +1462,14 @@ int dsa_slave_create(struct dsa_port *port)
 		free_netdev(slave_dev);
 		return -ENOMEM;
 	}
+	p->xmit_batch = alloc_percpu(struct dsa_slave_xmit_batch);
+	if (!p->xmit_batch) {
+		ret = -ENOMEM;
+		goto out_free_stats;
+	}
+	ret = gro_cells_init(&p->gcells, slave_dev);
+	if (ret)
+		goto out_free_batch;
 	p->dp = port;
 	INIT_LIST_HEAD(&p->mall_tc_list);
 	p->xmit = cpu_dp->tag_ops->xmit;
@@ -1361,12 +1500,25 @@ int dsa_slave_create(struct dsa_port *port)
 	rtnl_unlock();
 	phylink_destroy(p->dp->pl);
 out_free:
+	gro_cells_destroy(&p->gcells);
+out_free_batch:
+	free_percpu(p->xmit_batch);
+out_free_stats:
 	free_percpu(p->stats64);
 	free_netdev(slave_dev);
 	port->slave = NULL;
 	return ret;
 }
 
+static void dsa_slave_free_xmit_batch(struct dsa_slave_priv *p)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		kfree_skb_list(per_cpu_ptr(p->xmit_batch, cpu)->head);
+	free_percpu(p->xmit_batch);
+}
+
 void dsa_slave_destroy(struct net_device *slave_dev)
 {
 	struct dsa_port *dp = dsa_slave_to_port(slave_dev);
@@ -1380,6 +1532,8 @@ void dsa_slave_destroy(struct net_device *slave_dev)
 	dsa_slave_notify(slave_dev, DSA_PORT_UNREGISTER);
 	unregister_netdev(slave_dev);
 	phylink_destroy(dp->pl);
+	gro_cells_destroy(&p->gcells);
+	dsa_slave_free_xmit_batch(p);
 	free_percpu(p->stats64);
 	free_netdev(slave_dev);
 }
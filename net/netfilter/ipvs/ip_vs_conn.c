@@ -37,6 +37,10 @@
 #include <linux/seq_file.h>
 #include <linux/jhash.h>
 #include <linux/random.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/percpu.h>
+#include <linux/seqlock.h>
 
 #include <net/net_namespace.h>
 #include <net/ip_vs.h>
@@ -46,21 +50,42 @@
 #define CONFIG_IP_VS_TAB_BITS	12
 #endif
 
+static int ip_vs_conn_tab_bits_set(const char *val,
+				   const struct kernel_param *kp);
+
+static const struct kernel_param_ops ip_vs_conn_tab_bits_ops = {
+	.set	= ip_vs_conn_tab_bits_set,
+	.get	= param_get_int,
+};
+
 /*
- * Connection hash size. Default is what was selected at compile time.
+ * Connection hash size. Default is what was selected at compile time,
+ * writing the parameter later rehashes the connections into a new table.
 */
 static int ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
-module_param_named(conn_tab_bits, ip_vs_conn_tab_bits, int, 0444);
+module_param_cb(conn_tab_bits, &ip_vs_conn_tab_bits_ops,
+		&ip_vs_conn_tab_bits, 0644);
 MODULE_PARM_DESC(conn_tab_bits, "Set connections' hash size");
 
-/* size and mask values */
+/* size of the current table */
 int ip_vs_conn_tab_size __read_mostly;
-static int ip_vs_conn_tab_mask __read_mostly;
 
 /*
  *  Connection hash table: for input and output packets lookups of IPVS
  */
-static struct hlist_head *ip_vs_conn_tab __read_mostly;
+struct ip_vs_conn_tab {
+	unsigned int		mask;
+	struct hlist_head	buckets[];
+};
+
+static struct ip_vs_conn_tab __rcu *ip_vs_conn_tab __read_mostly;
+
+/* The table a resize is moving the connections to, searched after the other */
+static struct ip_vs_conn_tab __rcu *ip_vs_conn_tab_new __read_mostly;
+
+/* Bumped around each step of a resize, lookups racing with it search again */
+static seqcount_t ip_vs_conn_tab_seq = SEQCNT_ZERO(ip_vs_conn_tab_seq);
+static DEFINE_MUTEX(ip_vs_conn_tab_mutex);
 
 /*  SLAB cache for IPVS connections */
 static struct kmem_cache *ip_vs_conn_cachep __read_mostly;
@@ -72,11 +97,15 @@ static atomic_t ip_vs_conn_no_cport_cnt = ATOMIC_INIT(0);
 static unsigned int ip_vs_conn_rnd __read_mostly;
 
 /*
- *  Fine locking granularity for big connection hash table
+ *  Fine locking granularity for big connection hash table. The lock is
+ *  picked by the unmasked hash value, so a conn keeps it across resizes,
+ *  and the array grows with the number of CPUs inserting and unlinking.
+ *  There are never more locks than buckets in the smallest table, so all
+ *  conns of a bucket share one lock, in the old and the new table alike.
  */
-#define CT_LOCKARRAY_BITS  5
-#define CT_LOCKARRAY_SIZE  (1<<CT_LOCKARRAY_BITS)
-#define CT_LOCKARRAY_MASK  (CT_LOCKARRAY_SIZE-1)
+#define CT_LOCKARRAY_MIN	32
+#define CT_LOCKARRAY_MAX	256	/* 1 << the minimum conn_tab_bits */
+#define CT_LOCKS_PER_CPU	16
 
 /* We need an addrstrlen that works with or without v6 */
 #ifdef CONFIG_IP_VS_IPV6
@@ -91,23 +120,226 @@ struct ip_vs_aligned_lock
 } __attribute__((__aligned__(SMP_CACHE_BYTES)));
 
 /* lock array for conn table */
-static struct ip_vs_aligned_lock
-__ip_vs_conntbl_lock_array[CT_LOCKARRAY_SIZE] __cacheline_aligned;
+static struct ip_vs_aligned_lock *__ip_vs_conntbl_lock_array __read_mostly;
+static unsigned int ct_lockarray_mask __read_mostly;
 
 static inline void ct_write_lock_bh(unsigned int key)
 {
-	spin_lock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
+	spin_lock_bh(&__ip_vs_conntbl_lock_array[key & ct_lockarray_mask].l);
 }
 
 static inline void ct_write_unlock_bh(unsigned int key)
 {
-	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
+	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key & ct_lockarray_mask].l);
+}
+
+static inline struct hlist_head *
+ip_vs_conn_bucket(struct ip_vs_conn_tab *t, unsigned int hash)
+{
+	return &t->buckets[hash & t->mask];
+}
+
+/*
+ * Bucket for the hash under ct_write_lock_bh(). While a resize runs new
+ * conns go to the new table, the resize moves the old ones of our lock
+ * under that lock, before or after us.
+ */
+static inline struct hlist_head *ip_vs_conn_bucket_locked(unsigned int hash)
+{
+	struct ip_vs_conn_tab *t = rcu_dereference_bh(ip_vs_conn_tab_new);
+
+	/* pairs with smp_wmb() in ip_vs_conn_tab_resize() */
+	smp_rmb();
+	if (!t)
+		t = rcu_dereference_bh(ip_vs_conn_tab);
+	return ip_vs_conn_bucket(t, hash);
+}
+
+/* The table to search after t, if a resize is moving conns out of it */
+static inline struct ip_vs_conn_tab *
+ip_vs_conn_tab_next(struct ip_vs_conn_tab *t)
+{
+	struct ip_vs_conn_tab *nt = rcu_dereference(ip_vs_conn_tab_new);
+
+	return nt != t ? nt : NULL;
+}
+
+/*
+ *  Expiry wheels, one per CPU. A conn is queued on the wheel of the CPU
+ *  that armed its expiry, in the slot scanned at or after cp->expires.
+ *  Pushing the expiry further out only stores cp->expires, the scan moves
+ *  the conn on when its slot comes up, so a busy conn costs no timer
+ *  operation per packet. Expiries further out than the wheel spans are
+ *  queued in its last slot and moved on from there.
+ */
+#define IP_VS_CONN_WHEEL_SLOTS	512
+#define IP_VS_CONN_WHEEL_TICK	(HZ / 16)
+
+struct ip_vs_conn_wheel {
+	spinlock_t		lock;
+	struct timer_list	timer;
+	unsigned long		clock;		/* when slots[cursor] is due */
+	unsigned int		cursor;
+	unsigned int		count;		/* queued conns */
+	unsigned long		scanned;
+	unsigned long		expired;
+	struct hlist_head	slots[IP_VS_CONN_WHEEL_SLOTS];
+};
+
+static struct ip_vs_conn_wheel __percpu *ip_vs_conn_wheels __read_mostly;
+
+static void ip_vs_conn_expire(struct ip_vs_conn *cp);
+
+/* Queue cp in the slot due for cp->expires, w->lock held */
+static void ip_vs_conn_wheel_add(struct ip_vs_conn_wheel *w, int cpu,
+				 struct ip_vs_conn *cp)
+{
+	unsigned long expires = READ_ONCE(cp->expires);
+	unsigned long ticks = 0;
+
+	/* nothing queued, restart the clock from now */
+	if (!w->count)
+		w->clock = jiffies;
+	if (time_after(expires, w->clock))
+		ticks = min_t(unsigned long,
+			      DIV_ROUND_UP(expires - w->clock,
+					   IP_VS_CONN_WHEEL_TICK),
+			      IP_VS_CONN_WHEEL_SLOTS - 1);
+
+	WRITE_ONCE(cp->exp_due, w->clock + ticks * IP_VS_CONN_WHEEL_TICK);
+	hlist_add_head(&cp->exp_node,
+		       &w->slots[(w->cursor + ticks) &
+				 (IP_VS_CONN_WHEEL_SLOTS - 1)]);
+	WRITE_ONCE(cp->exp_cpu, cpu);
+	w->count++;
+
+	if (!timer_pending(&w->timer))
+		mod_timer(&w->timer, w->clock);
+}
+
+/* Take cp off its wheel, w->lock held */
+static void ip_vs_conn_wheel_del(struct ip_vs_conn_wheel *w,
+				 struct ip_vs_conn *cp)
+{
+	hlist_del_init(&cp->exp_node);
+	w->count--;
+	/* exp_node is free once another CPU sees -1 */
+	smp_store_release(&cp->exp_cpu, -1);
+}
+
+/* Queue cp again on the same wheel, w->lock held */
+static void ip_vs_conn_wheel_move(struct ip_vs_conn_wheel *w,
+				  struct ip_vs_conn *cp)
+{
+	hlist_del(&cp->exp_node);
+	w->count--;
+	ip_vs_conn_wheel_add(w, cp->exp_cpu, cp);
+}
+
+/* Lock the wheel cp is queued on, returns NULL if it is on none */
+static struct ip_vs_conn_wheel *ip_vs_conn_wheel_lock(struct ip_vs_conn *cp)
+{
+	struct ip_vs_conn_wheel *w;
+	int cpu;
+
+	for (;;) {
+		cpu = READ_ONCE(cp->exp_cpu);
+		if (cpu < 0)
+			return NULL;
+		w = per_cpu_ptr(ip_vs_conn_wheels, cpu);
+		spin_lock_bh(&w->lock);
+		if (cp->exp_cpu == cpu)
+			return w;
+		spin_unlock_bh(&w->lock);
+	}
+}
+
+/* Set a new expiry time, queueing the conn if it is not queued yet */
+static void ip_vs_conn_mod_expiry(struct ip_vs_conn *cp,
+				  unsigned long expires)
+{
+	struct ip_vs_conn_wheel *w;
+	bool queued;
+	int cpu;
+
+	WRITE_ONCE(cp->expires, expires);
+	if (ip_vs_conn_expiry_pending(cp) &&
+	    !time_before(expires, READ_ONCE(cp->exp_due)))
+		return;
+
+	for (;;) {
+		w = ip_vs_conn_wheel_lock(cp);
+		if (w) {
+			/* its slot is due too late for the new expiry */
+			if (time_before(READ_ONCE(cp->expires), cp->exp_due))
+				ip_vs_conn_wheel_move(w, cp);
+			spin_unlock_bh(&w->lock);
+			return;
+		}
+
+		local_bh_disable();
+		cpu = smp_processor_id();
+		w = this_cpu_ptr(ip_vs_conn_wheels);
+		spin_lock(&w->lock);
+		/* another user may have queued it meanwhile */
+		queued = cmpxchg(&cp->exp_cpu, -1, cpu) == -1;
+		if (queued)
+			ip_vs_conn_wheel_add(w, cpu, cp);
+		spin_unlock(&w->lock);
+		local_bh_enable();
+		if (queued)
+			return;
+	}
+}
+
+/* Take cp off its wheel, if it is queued */
+static void ip_vs_conn_del_expiry(struct ip_vs_conn *cp)
+{
+	struct ip_vs_conn_wheel *w = ip_vs_conn_wheel_lock(cp);
+
+	if (w) {
+		ip_vs_conn_wheel_del(w, cp);
+		spin_unlock_bh(&w->lock);
+	}
 }
 
-static void ip_vs_conn_expire(struct timer_list *t);
+/* Scan the slots that are due, the lock is dropped around each expiry */
+static void ip_vs_conn_wheel_run(struct timer_list *t)
+{
+	struct ip_vs_conn_wheel *w = from_timer(w, t, timer);
+	struct ip_vs_conn *cp;
+	HLIST_HEAD(due);
+
+	spin_lock(&w->lock);
+	while (w->count && time_before_eq(w->clock, jiffies)) {
+		hlist_move_list(&w->slots[w->cursor], &due);
+		w->cursor = (w->cursor + 1) & (IP_VS_CONN_WHEEL_SLOTS - 1);
+		w->clock += IP_VS_CONN_WHEEL_TICK;
+
+		/* conns still on due can be moved by others meanwhile */
+		while (!hlist_empty(&due)) {
+			cp = hlist_entry(due.first, struct ip_vs_conn,
+					 exp_node);
+			w->scanned++;
+			if (time_after(READ_ONCE(cp->expires), jiffies)) {
+				ip_vs_conn_wheel_move(w, cp);
+				continue;
+			}
+			ip_vs_conn_wheel_del(w, cp);
+			w->expired++;
+			spin_unlock(&w->lock);
+			ip_vs_conn_expire(cp);
+			spin_lock(&w->lock);
+		}
+	}
+	if (w->count && !timer_pending(&w->timer))
+		mod_timer(&w->timer, w->clock);
+	spin_unlock(&w->lock);
+}
 
 /*
- *	Returns hash value for IPVS connection entry
+ *	Returns hash value for IPVS connection entry, the bucket and the
+ *	ct lock are taken from its low bits
  */
 static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned int proto,
 				       const union nf_inet_addr *addr,
@@ -115,13 +347,13 @@ static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned
 {
 #ifdef CONFIG_IP_VS_IPV6
 	if (af == AF_INET6)
-		return (jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
+		return jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
 				    (__force u32)port, proto, ip_vs_conn_rnd) ^
-			((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+			((size_t)ipvs>>8);
 #endif
-	return (jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
+	return jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
 			    ip_vs_conn_rnd) ^
-		((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+		((size_t)ipvs>>8);
 }
 
 static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
@@ -131,8 +363,7 @@ static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
 	__be16 port;
 
 	if (p->pe_data && p->pe->hashkey_raw)
-		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse) &
-			ip_vs_conn_tab_mask;
+		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse);
 
 	if (likely(!inverse)) {
 		addr = p->caddr;
@@ -182,7 +413,7 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	if (!(cp->flags & IP_VS_CONN_F_HASHED)) {
 		cp->flags |= IP_VS_CONN_F_HASHED;
 		refcount_inc(&cp->refcnt);
-		hlist_add_head_rcu(&cp->c_list, &ip_vs_conn_tab[hash]);
+		hlist_add_head_rcu(&cp->c_list, ip_vs_conn_bucket_locked(hash));
 		ret = 1;
 	} else {
 		pr_err("%s(): request for already hashed, called from %pS\n",
@@ -267,28 +498,39 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 static inline struct ip_vs_conn *
 __ip_vs_conn_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	unsigned int hash, seq;
+	struct ip_vs_conn_tab *t;
 	struct ip_vs_conn *cp;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->cport == cp->cport && p->vport == cp->vport &&
-		    cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->vaddr) &&
-		    ((!p->cport) ^ (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			rcu_read_unlock();
-			return cp;
+	do {
+		seq = read_seqcount_begin(&ip_vs_conn_tab_seq);
+		for (t = rcu_dereference(ip_vs_conn_tab); t;
+		     t = ip_vs_conn_tab_next(t)) {
+			hlist_for_each_entry_rcu(cp, ip_vs_conn_bucket(t, hash),
+						 c_list) {
+				if (p->cport == cp->cport &&
+				    p->vport == cp->vport && cp->af == p->af &&
+				    ip_vs_addr_equal(p->af, p->caddr,
+						     &cp->caddr) &&
+				    ip_vs_addr_equal(p->af, p->vaddr,
+						     &cp->vaddr) &&
+				    ((!p->cport) ^
+				     (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
+				    p->protocol == cp->protocol &&
+				    cp->ipvs == p->ipvs) {
+					if (!__ip_vs_conn_get(cp))
+						continue;
+					/* HIT */
+					rcu_read_unlock();
+					return cp;
+				}
+			}
 		}
-	}
+	} while (read_seqcount_retry(&ip_vs_conn_tab_seq, seq));
 
 	rcu_read_unlock();
 
@@ -353,38 +595,50 @@ EXPORT_SYMBOL_GPL(ip_vs_conn_in_get_proto);
 /* Get reference to connection template */
 struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	unsigned int hash, seq;
+	struct ip_vs_conn_tab *t;
 	struct ip_vs_conn *cp;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (unlikely(p->pe_data && p->pe->ct_match)) {
-			if (cp->ipvs != p->ipvs)
-				continue;
-			if (p->pe == cp->pe && p->pe->ct_match(p, cp)) {
-				if (__ip_vs_conn_get(cp))
-					goto out;
-			}
-			continue;
-		}
+	do {
+		seq = read_seqcount_begin(&ip_vs_conn_tab_seq);
+		for (t = rcu_dereference(ip_vs_conn_tab); t;
+		     t = ip_vs_conn_tab_next(t)) {
+			hlist_for_each_entry_rcu(cp, ip_vs_conn_bucket(t, hash),
+						 c_list) {
+				if (unlikely(p->pe_data && p->pe->ct_match)) {
+					if (cp->ipvs != p->ipvs)
+						continue;
+					if (p->pe == cp->pe &&
+					    p->pe->ct_match(p, cp)) {
+						if (__ip_vs_conn_get(cp))
+							goto out;
+					}
+					continue;
+				}
 
-		if (cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    /* protocol should only be IPPROTO_IP if
-		     * p->vaddr is a fwmark */
-		    ip_vs_addr_equal(p->protocol == IPPROTO_IP ? AF_UNSPEC :
-				     p->af, p->vaddr, &cp->vaddr) &&
-		    p->vport == cp->vport && p->cport == cp->cport &&
-		    cp->flags & IP_VS_CONN_F_TEMPLATE &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (__ip_vs_conn_get(cp))
-				goto out;
+				if (cp->af == p->af &&
+				    ip_vs_addr_equal(p->af, p->caddr,
+						     &cp->caddr) &&
+				    /* protocol should only be IPPROTO_IP if
+				     * p->vaddr is a fwmark */
+				    ip_vs_addr_equal(p->protocol == IPPROTO_IP ?
+						     AF_UNSPEC : p->af,
+						     p->vaddr, &cp->vaddr) &&
+				    p->vport == cp->vport &&
+				    p->cport == cp->cport &&
+				    cp->flags & IP_VS_CONN_F_TEMPLATE &&
+				    p->protocol == cp->protocol &&
+				    cp->ipvs == p->ipvs) {
+					if (__ip_vs_conn_get(cp))
+						goto out;
+				}
+			}
 		}
-	}
+	} while (read_seqcount_retry(&ip_vs_conn_tab_seq, seq));
 	cp = NULL;
 
   out:
@@ -405,7 +659,8 @@ struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
  *	p->vaddr, p->vport: pkt dest address (foreign host) */
 struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	unsigned int hash, seq;
+	struct ip_vs_conn_tab *t;
 	struct ip_vs_conn *cp, *ret=NULL;
 
 	/*
@@ -415,21 +670,31 @@ struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->vport == cp->cport && p->cport == cp->dport &&
-		    cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->daddr) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			ret = cp;
-			break;
+	do {
+		seq = read_seqcount_begin(&ip_vs_conn_tab_seq);
+		for (t = rcu_dereference(ip_vs_conn_tab); t;
+		     t = ip_vs_conn_tab_next(t)) {
+			hlist_for_each_entry_rcu(cp, ip_vs_conn_bucket(t, hash),
+						 c_list) {
+				if (p->vport == cp->cport &&
+				    p->cport == cp->dport && cp->af == p->af &&
+				    ip_vs_addr_equal(p->af, p->vaddr,
+						     &cp->caddr) &&
+				    ip_vs_addr_equal(p->af, p->caddr,
+						     &cp->daddr) &&
+				    p->protocol == cp->protocol &&
+				    cp->ipvs == p->ipvs) {
+					if (!__ip_vs_conn_get(cp))
+						continue;
+					/* HIT */
+					ret = cp;
+					goto out;
+				}
+			}
 		}
-	}
+	} while (read_seqcount_retry(&ip_vs_conn_tab_seq, seq));
 
+  out:
 	rcu_read_unlock();
 
 	IP_VS_DBG_BUF(9, "lookup/out %s %s:%d->%s:%d %s\n",
@@ -456,13 +721,13 @@ ip_vs_conn_out_get_proto(struct netns_ipvs *ipvs, int af,
 EXPORT_SYMBOL_GPL(ip_vs_conn_out_get_proto);
 
 /*
- *      Put back the conn and restart its timer with its timeout
+ *      Put back the conn and restart its expiry with its timeout
  */
 static void __ip_vs_conn_put_timer(struct ip_vs_conn *cp)
 {
 	unsigned long t = (cp->flags & IP_VS_CONN_F_ONE_PACKET) ?
 		0 : cp->timeout;
-	mod_timer(&cp->timer, jiffies+t);
+	ip_vs_conn_mod_expiry(cp, jiffies+t);
 
 	__ip_vs_conn_put(cp);
 }
@@ -471,9 +736,9 @@ void ip_vs_conn_put(struct ip_vs_conn *cp)
 {
 	if ((cp->flags & IP_VS_CONN_F_ONE_PACKET) &&
 	    (refcount_read(&cp->refcnt) == 1) &&
-	    !timer_pending(&cp->timer))
+	    !ip_vs_conn_expiry_pending(cp))
 		/* expire connection immediately */
-		ip_vs_conn_expire(&cp->timer);
+		ip_vs_conn_expire(cp);
 	else
 		__ip_vs_conn_put_timer(cp);
 }
@@ -812,9 +1077,8 @@ static void ip_vs_conn_rcu_free(struct rcu_head *head)
 	kmem_cache_free(ip_vs_conn_cachep, cp);
 }
 
-static void ip_vs_conn_expire(struct timer_list *t)
+static void ip_vs_conn_expire(struct ip_vs_conn *cp)
 {
-	struct ip_vs_conn *cp = from_timer(cp, t, timer);
 	struct netns_ipvs *ipvs = cp->ipvs;
 
 	/*
@@ -827,8 +1091,8 @@ static void ip_vs_conn_expire(struct timer_list *t)
 	if (likely(ip_vs_conn_unlink(cp))) {
 		struct ip_vs_conn *ct = cp->control;
 
-		/* delete the timer if it is activated by other users */
-		del_timer(&cp->timer);
+		/* dequeue it if it was queued again by other users */
+		ip_vs_conn_del_expiry(cp);
 
 		/* does anybody control me? */
 		if (ct) {
@@ -881,7 +1145,7 @@ static void ip_vs_conn_expire(struct timer_list *t)
 	__ip_vs_conn_put_timer(cp);
 }
 
-/* Modify timer, so that it expires as soon as possible.
+/* Requeue the conn, so that it expires as soon as possible.
  * Can be called without reference only if under RCU lock.
  * We can have such chain of conns linked with ->control: DATA->CTL->TPL
  * - DATA (eg. FTP) and TPL (persistence) can be present depending on setup
@@ -890,12 +1154,19 @@ static void ip_vs_conn_expire(struct timer_list *t)
  */
 void ip_vs_conn_expire_now(struct ip_vs_conn *cp)
 {
-	/* Using mod_timer_pending will ensure the timer is not
-	 * modified after the final del_timer in ip_vs_conn_expire.
+	struct ip_vs_conn_wheel *w;
+
+	/* Only a queued conn is touched, so it is never queued again
+	 * after the final dequeue in ip_vs_conn_expire.
 	 */
-	if (timer_pending(&cp->timer) &&
-	    time_after(cp->timer.expires, jiffies))
-		mod_timer_pending(&cp->timer, jiffies);
+	w = ip_vs_conn_wheel_lock(cp);
+	if (!w)
+		return;
+	if (time_after(cp->expires, jiffies))
+		WRITE_ONCE(cp->expires, jiffies);
+	if (time_after(cp->exp_due, w->clock))
+		ip_vs_conn_wheel_move(w, cp);
+	spin_unlock_bh(&w->lock);
 }
 
 
@@ -919,7 +1190,10 @@ ip_vs_conn_new(const struct ip_vs_conn_param *p, int dest_af,
 	}
 
 	INIT_HLIST_NODE(&cp->c_list);
-	timer_setup(&cp->timer, ip_vs_conn_expire, 0);
+	INIT_HLIST_NODE(&cp->exp_node);
+	cp->expires = jiffies;
+	cp->exp_due = jiffies;
+	cp->exp_cpu = -1;
 	cp->ipvs	   = ipvs;
 	cp->af		   = p->af;
 	cp->daf		   = dest_af;
@@ -1011,26 +1285,31 @@ ip_vs_conn_new(const struct ip_vs_conn_param *p, int dest_af,
 #ifdef CONFIG_PROC_FS
 struct ip_vs_iter_state {
 	struct seq_net_private	p;
+	struct ip_vs_conn_tab	*t;	/* table l is in */
 	struct hlist_head	*l;
 };
 
 static void *ip_vs_conn_array(struct seq_file *seq, loff_t pos)
 {
-	int idx;
+	unsigned int idx;
 	struct ip_vs_conn *cp;
 	struct ip_vs_iter_state *iter = seq->private;
+	struct ip_vs_conn_tab *t = rcu_dereference(ip_vs_conn_tab);
 
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+	for (idx = 0; idx <= t->mask; idx++) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[idx], c_list) {
 			/* __ip_vs_conn_get() is not needed by
 			 * ip_vs_conn_seq_show and ip_vs_conn_sync_seq_show
 			 */
 			if (pos-- == 0) {
-				iter->l = &ip_vs_conn_tab[idx];
+				iter->t = t;
+				iter->l = &t->buckets[idx];
 				return cp;
 			}
 		}
 		cond_resched_rcu();
+		/* a resize may have replaced it meanwhile */
+		t = rcu_dereference(ip_vs_conn_tab);
 	}
 
 	return NULL;
@@ -1052,7 +1331,8 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 	struct ip_vs_iter_state *iter = seq->private;
 	struct hlist_node *e;
 	struct hlist_head *l = iter->l;
-	int idx;
+	struct ip_vs_conn_tab *t;
+	unsigned int idx;
 
 	++*pos;
 	if (v == SEQ_START_TOKEN)
@@ -1063,13 +1343,16 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 	if (e)
 		return hlist_entry(e, struct ip_vs_conn, c_list);
 
-	idx = l - ip_vs_conn_tab;
-	while (++idx < ip_vs_conn_tab_size) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
-			iter->l = &ip_vs_conn_tab[idx];
+	t = iter->t;
+	idx = l - t->buckets;
+	while (++idx <= t->mask) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[idx], c_list) {
+			iter->t = t;
+			iter->l = &t->buckets[idx];
 			return cp;
 		}
 		cond_resched_rcu();
+		t = rcu_dereference(ip_vs_conn_tab);
 	}
 	iter->l = NULL;
 	return NULL;
@@ -1123,7 +1406,7 @@ static int ip_vs_conn_seq_show(struct seq_file *seq, void *v)
 				&cp->vaddr.in6, ntohs(cp->vport),
 				dbuf, ntohs(cp->dport),
 				ip_vs_state_name(cp),
-				jiffies_delta_to_msecs(cp->timer.expires -
+				jiffies_delta_to_msecs(READ_ONCE(cp->expires) -
 						       jiffies) / 1000,
 				pe_data);
 		else
@@ -1136,7 +1419,7 @@ static int ip_vs_conn_seq_show(struct seq_file *seq, void *v)
 				ntohl(cp->vaddr.ip), ntohs(cp->vport),
 				dbuf, ntohs(cp->dport),
 				ip_vs_state_name(cp),
-				jiffies_delta_to_msecs(cp->timer.expires -
+				jiffies_delta_to_msecs(READ_ONCE(cp->expires) -
 						       jiffies) / 1000,
 				pe_data);
 	}
@@ -1190,7 +1473,7 @@ static int ip_vs_conn_sync_seq_show(struct seq_file *seq, void *v)
 				dbuf, ntohs(cp->dport),
 				ip_vs_state_name(cp),
 				ip_vs_origin_name(cp->flags),
-				jiffies_delta_to_msecs(cp->timer.expires -
+				jiffies_delta_to_msecs(READ_ONCE(cp->expires) -
 						       jiffies) / 1000);
 		else
 #endif
@@ -1203,7 +1486,7 @@ static int ip_vs_conn_sync_seq_show(struct seq_file *seq, void *v)
 				dbuf, ntohs(cp->dport),
 				ip_vs_state_name(cp),
 				ip_vs_origin_name(cp->flags),
-				jiffies_delta_to_msecs(cp->timer.expires -
+				jiffies_delta_to_msecs(READ_ONCE(cp->expires) -
 						       jiffies) / 1000);
 	}
 	return 0;
@@ -1215,6 +1498,56 @@ static const struct seq_operations ip_vs_conn_sync_seq_ops = {
 	.stop  = ip_vs_conn_seq_stop,
 	.show  = ip_vs_conn_sync_seq_show,
 };
+
+/*
+ *	/proc/net/ip_vs_conn_stats: the table and the wheels are shared by
+ *	all netns, so the chains count only the conns of this one and the
+ *	wheel figures are only shown in init_net
+ */
+static int ip_vs_conn_stats_show(struct seq_file *seq, void *v)
+{
+	struct net *net = seq_file_single_net(seq);
+	struct netns_ipvs *ipvs = net_ipvs(net);
+	unsigned int idx, len, used = 0, longest = 0;
+	struct ip_vs_conn_wheel *w;
+	struct ip_vs_conn_tab *t;
+	struct ip_vs_conn *cp;
+	int cpu;
+
+	rcu_read_lock();
+	t = rcu_dereference(ip_vs_conn_tab);
+	for (idx = 0; idx <= t->mask; idx++) {
+		len = 0;
+		hlist_for_each_entry_rcu(cp, &t->buckets[idx], c_list) {
+			if (cp->ipvs == ipvs)
+				len++;
+		}
+		if (len)
+			used++;
+		longest = max(longest, len);
+		cond_resched_rcu();
+		t = rcu_dereference(ip_vs_conn_tab);
+	}
+	rcu_read_unlock();
+
+	seq_puts(seq,
+		 " Buckets    Locks    Conns  Used buckets  Longest chain\n");
+	seq_printf(seq, "%8d %8u %8d %13u %14u\n",
+		   ip_vs_conn_tab_size, ct_lockarray_mask + 1,
+		   atomic_read(&ipvs->conn_count), used, longest);
+
+	if (!net_eq(net, &init_net))
+		return 0;
+
+	seq_puts(seq, "CPU   Queued      Scanned      Expired\n");
+	for_each_possible_cpu(cpu) {
+		w = per_cpu_ptr(ip_vs_conn_wheels, cpu);
+		seq_printf(seq, "%3d %8u %12lu %12lu\n", cpu,
+			   READ_ONCE(w->count), READ_ONCE(w->scanned),
+			   READ_ONCE(w->expired));
+	}
+	return 0;
+}
 #endif
 
 
@@ -1237,7 +1570,7 @@ static inline int todrop_entry(struct ip_vs_conn *cp)
 	/* if the conn entry hasn't lasted for 60 seconds, don't drop it.
 	   This will leave enough time for normal connection to get
 	   through. */
-	if (time_before(cp->timeout + jiffies, cp->timer.expires + 60*HZ))
+	if (time_before(cp->timeout + jiffies, READ_ONCE(cp->expires) + 60*HZ))
 		return 0;
 
 	/* Don't drop the entry if its number of incoming packets is not
@@ -1267,15 +1600,18 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
 {
 	int idx;
 	struct ip_vs_conn *cp;
+	struct ip_vs_conn_tab *t;
 
 	rcu_read_lock();
 	/*
 	 * Randomly scan 1/32 of the whole table every second
 	 */
 	for (idx = 0; idx < (ip_vs_conn_tab_size>>5); idx++) {
-		unsigned int hash = prandom_u32() & ip_vs_conn_tab_mask;
+		unsigned int hash = prandom_u32();
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
+		t = rcu_dereference(ip_vs_conn_tab);
+		hlist_for_each_entry_rcu(cp, ip_vs_conn_bucket(t, hash),
+					 c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1336,19 +1672,21 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
  */
 static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 {
-	int idx;
+	unsigned int idx;
 	struct ip_vs_conn *cp, *cp_c;
+	struct ip_vs_conn_tab *t;
 
 flush_again:
 	rcu_read_lock();
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
+	t = rcu_dereference(ip_vs_conn_tab);
+	for (idx = 0; idx <= t->mask; idx++) {
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[idx], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
-			/* As timers are expired in LIFO order, restart
-			 * the timer of controlling connection first, so
-			 * that it is expired after us.
+			/* As slots are expired in LIFO order, requeue
+			 * the controlling connection first, so that it
+			 * is expired after us.
 			 */
 			cp_c = cp->control;
 			/* cp->control is valid only with reference to cp */
@@ -1361,6 +1699,7 @@ static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 			ip_vs_conn_expire_now(cp);
 		}
 		cond_resched_rcu();
+		t = rcu_dereference(ip_vs_conn_tab);
 	}
 	rcu_read_unlock();
 
@@ -1383,6 +1722,8 @@ int __net_init ip_vs_conn_net_init(struct netns_ipvs *ipvs)
 	proc_create_net("ip_vs_conn_sync", 0, ipvs->net->proc_net,
 			&ip_vs_conn_sync_seq_ops,
 			sizeof(struct ip_vs_iter_state));
+	proc_create_net_single("ip_vs_conn_stats", 0, ipvs->net->proc_net,
+			       ip_vs_conn_stats_show, NULL);
 	return 0;
 }
 
@@ -1392,58 +1733,202 @@ void __net_exit ip_vs_conn_net_cleanup(struct netns_ipvs *ipvs)
 	ip_vs_conn_flush(ipvs);
 	remove_proc_entry("ip_vs_conn", ipvs->net->proc_net);
 	remove_proc_entry("ip_vs_conn_sync", ipvs->net->proc_net);
+	remove_proc_entry("ip_vs_conn_stats", ipvs->net->proc_net);
 }
 
-int __init ip_vs_conn_init(void)
+static struct ip_vs_conn_tab *ip_vs_conn_tab_alloc(int bits)
 {
-	int idx;
+	unsigned int idx, size = 1U << bits;
+	struct ip_vs_conn_tab *t;
+
+	t = vmalloc(struct_size(t, buckets, size));
+	if (!t)
+		return NULL;
+	t->mask = size - 1;
+	for (idx = 0; idx < size; idx++)
+		INIT_HLIST_HEAD(&t->buckets[idx]);
+	return t;
+}
+
+/*
+ * Rehash all connections into a table of 2^bits buckets. New conns are
+ * hashed into the new table while the old ones are moved over one ct lock
+ * at a time, and lookups search both tables until the new one takes over.
+ * Hashing and unhashing only ever wait for the ct lock being moved.
+ */
+static int ip_vs_conn_tab_resize(int bits)
+{
+	struct ip_vs_conn_tab *t, *old;
+	unsigned int idx, lock;
+	struct hlist_node *next;
+	struct ip_vs_conn *cp;
+	int ret = 0;
+
+	mutex_lock(&ip_vs_conn_tab_mutex);
+	old = rcu_dereference_protected(ip_vs_conn_tab,
+					lockdep_is_held(&ip_vs_conn_tab_mutex));
+	/* not set up yet, ip_vs_conn_init() picks up the new size */
+	if (!old || old->mask == (1U << bits) - 1)
+		goto out;
+
+	t = ip_vs_conn_tab_alloc(bits);
+	if (!t) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	rcu_assign_pointer(ip_vs_conn_tab_new, t);
+
+	/* the buckets of a lock are lock, lock + locks, ... in either table */
+	for (lock = 0; lock <= ct_lockarray_mask; lock++) {
+		spin_lock_bh(&__ip_vs_conntbl_lock_array[lock].l);
+		write_seqcount_begin(&ip_vs_conn_tab_seq);
+		for (idx = lock; idx <= old->mask;
+		     idx += ct_lockarray_mask + 1) {
+			hlist_for_each_entry_safe(cp, next, &old->buckets[idx],
+						  c_list) {
+				hlist_del_rcu(&cp->c_list);
+				hlist_add_head_rcu(&cp->c_list,
+					ip_vs_conn_bucket(t,
+						ip_vs_conn_hashkey_conn(cp)));
+			}
+		}
+		write_seqcount_end(&ip_vs_conn_tab_seq);
+		spin_unlock_bh(&__ip_vs_conntbl_lock_array[lock].l);
+		cond_resched();
+	}
+
+	local_bh_disable();
+	write_seqcount_begin(&ip_vs_conn_tab_seq);
+	rcu_assign_pointer(ip_vs_conn_tab, t);
+	/* ip_vs_conn_bucket_locked() finds one of them set at any time */
+	smp_wmb();
+	RCU_INIT_POINTER(ip_vs_conn_tab_new, NULL);
+	ip_vs_conn_tab_size = t->mask + 1;
+	write_seqcount_end(&ip_vs_conn_tab_seq);
+	local_bh_enable();
+
+	pr_info("Connection hash table resized (size=%d)\n",
+		ip_vs_conn_tab_size);
+
+	synchronize_rcu();
+	vfree(old);
+out:
+	mutex_unlock(&ip_vs_conn_tab_mutex);
+	return ret;
+}
+
+static int ip_vs_conn_tab_bits_set(const char *val,
+				   const struct kernel_param *kp)
+{
+	int bits, ret;
 
-	/* Compute size and mask */
-	ip_vs_conn_tab_size = 1 << ip_vs_conn_tab_bits;
-	ip_vs_conn_tab_mask = ip_vs_conn_tab_size - 1;
+	ret = kstrtoint(val, 0, &bits);
+	if (ret)
+		return ret;
+	if (bits < 8 || bits > 20)
+		return -EINVAL;
+
+	ret = ip_vs_conn_tab_resize(bits);
+	if (!ret)
+		*(int *)kp->arg = bits;
+	return ret;
+}
+
+int __init ip_vs_conn_init(void)
+{
+	struct ip_vs_conn_wheel *w;
+	struct ip_vs_conn_tab *t;
+	unsigned int locks;
+	int idx, cpu;
 
 	/*
 	 * Allocate the connection hash table and initialize its list heads
 	 */
-	ip_vs_conn_tab = vmalloc(array_size(ip_vs_conn_tab_size,
-					    sizeof(*ip_vs_conn_tab)));
-	if (!ip_vs_conn_tab)
+	t = ip_vs_conn_tab_alloc(ip_vs_conn_tab_bits);
+	if (!t)
 		return -ENOMEM;
+	ip_vs_conn_tab_size = t->mask + 1;
+
+	locks = clamp_t(unsigned int,
+			roundup_pow_of_two(num_possible_cpus() *
+					   CT_LOCKS_PER_CPU),
+			CT_LOCKARRAY_MIN, CT_LOCKARRAY_MAX);
+	__ip_vs_conntbl_lock_array =
+		kvmalloc_array(locks, sizeof(*__ip_vs_conntbl_lock_array),
+			       GFP_KERNEL);
+	if (!__ip_vs_conntbl_lock_array)
+		goto err_tab;
+	ct_lockarray_mask = locks - 1;
+
+	ip_vs_conn_wheels = alloc_percpu(struct ip_vs_conn_wheel);
+	if (!ip_vs_conn_wheels)
+		goto err_locks;
 
 	/* Allocate ip_vs_conn slab cache */
 	ip_vs_conn_cachep = kmem_cache_create("ip_vs_conn",
 					      sizeof(struct ip_vs_conn), 0,
 					      SLAB_HWCACHE_ALIGN, NULL);
-	if (!ip_vs_conn_cachep) {
-		vfree(ip_vs_conn_tab);
-		return -ENOMEM;
-	}
+	if (!ip_vs_conn_cachep)
+		goto err_wheels;
 
 	pr_info("Connection hash table configured "
-		"(size=%d, memory=%ldKbytes)\n",
+		"(size=%d, memory=%ldKbytes, locks=%u)\n",
 		ip_vs_conn_tab_size,
-		(long)(ip_vs_conn_tab_size*sizeof(struct list_head))/1024);
+		(long)(ip_vs_conn_tab_size*sizeof(struct list_head))/1024,
+		locks);
 	IP_VS_DBG(0, "Each connection entry needs %zd bytes at least\n",
 		  sizeof(struct ip_vs_conn));
 
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++)
-		INIT_HLIST_HEAD(&ip_vs_conn_tab[idx]);
-
-	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)  {
+	for (idx = 0; idx < locks; idx++)  {
 		spin_lock_init(&__ip_vs_conntbl_lock_array[idx].l);
 	}
 
+	/* the slots start out empty, zeroed by alloc_percpu() */
+	for_each_possible_cpu(cpu) {
+		w = per_cpu_ptr(ip_vs_conn_wheels, cpu);
+		spin_lock_init(&w->lock);
+		timer_setup(&w->timer, ip_vs_conn_wheel_run, 0);
+		w->clock = jiffies;
+	}
+
 	/* calculate the random value for connection hash */
 	get_random_bytes(&ip_vs_conn_rnd, sizeof(ip_vs_conn_rnd));
 
+	mutex_lock(&ip_vs_conn_tab_mutex);
+	rcu_assign_pointer(ip_vs_conn_tab, t);
+	mutex_unlock(&ip_vs_conn_tab_mutex);
+
 	return 0;
+
+err_wheels:
+	free_percpu(ip_vs_conn_wheels);
+err_locks:
+	kvfree(__ip_vs_conntbl_lock_array);
+err_tab:
+	vfree(t);
+	return -ENOMEM;
 }
 
 void ip_vs_conn_cleanup(void)
 {
+	struct ip_vs_conn_tab *t;
+	int cpu;
+
+	mutex_lock(&ip_vs_conn_tab_mutex);
+	t = rcu_dereference_protected(ip_vs_conn_tab,
+				      lockdep_is_held(&ip_vs_conn_tab_mutex));
+	RCU_INIT_POINTER(ip_vs_conn_tab, NULL);
+	mutex_unlock(&ip_vs_conn_tab_mutex);
+
 	/* Wait all ip_vs_conn_rcu_free() callbacks to complete */
 	rcu_barrier();
+	/* The wheels are empty, only their timers may still be pending */
+	for_each_possible_cpu(cpu)
+		del_timer_sync(&per_cpu_ptr(ip_vs_conn_wheels, cpu)->timer);
+	free_percpu(ip_vs_conn_wheels);
 	/* Release the empty cache */
 	kmem_cache_destroy(ip_vs_conn_cachep);
-	vfree(ip_vs_conn_tab);
+	kvfree(__ip_vs_conntbl_lock_array);
+	vfree(t);
 }
@@ -1975,7 +1975,7 @@ ip_vs_in(struct netns_ipvs *ipvs, unsigned int hooknum, struct sk_buff *skb, int
 		__u32 flags = cp->flags;
 
 		/* when timer already started, silently drop the packet.*/
-		if (timer_pending(&cp->timer))
+		if (ip_vs_conn_expiry_pending(cp))
 			__ip_vs_conn_put(cp);
 		else
 			ip_vs_conn_put(cp);
@@ -519,8 +519,12 @@ static void prb_setup_retire_blk_timer(struct packet_sock *po)
 	struct tpacket_kbdq_core *pkc;
 
 	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	/* A bound ring keeps its timer next to the CPU filling the blocks,
+	 * instead of letting it migrate to whichever CPU is busy.
+	 */
+	pkc->retire_blk_cpu = po->ring_cpu;
 	timer_setup(&pkc->retire_blk_timer, prb_retire_rx_blk_timer_expired,
-		    0);
+		    pkc->retire_blk_cpu >= 0 ? TIMER_PINNED : 0);
 	pkc->retire_blk_timer.expires = jiffies;
 }
 
@@ -611,8 +615,17 @@ static void init_prb_bdqc(struct packet_sock *po,
  */
 static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	mod_timer(&pkc->retire_blk_timer,
-			jiffies + pkc->tov_in_jiffies);
+	int cpu = pkc->retire_blk_cpu;
+
+	if (cpu < 0 || cpu == smp_processor_id() || !cpu_online(cpu)) {
+		mod_timer(&pkc->retire_blk_timer,
+				jiffies + pkc->tov_in_jiffies);
+	} else {
+		/* Opened from elsewhere, e.g. at setup: move it back */
+		del_timer(&pkc->retire_blk_timer);
+		pkc->retire_blk_timer.expires = jiffies + pkc->tov_in_jiffies;
+		add_timer_on(&pkc->retire_blk_timer, cpu);
+	}
 	pkc->last_kactive_blk_num = pkc->kactive_blk_num;
 }
 
@@ -1384,6 +1397,16 @@ static unsigned int fanout_demux_qm(struct packet_fanout *f,
 	return skb_get_queue_mapping(skb) % num;
 }
 
+static unsigned int fanout_demux_cpu_ring(struct packet_fanout *f,
+					  struct sk_buff *skb,
+					  unsigned int num)
+{
+	unsigned int cpu = smp_processor_id();
+	unsigned int idx = READ_ONCE(f->cpu_map[cpu]);
+
+	return idx < num ? idx : cpu % num;
+}
+
 static unsigned int fanout_demux_bpf(struct packet_fanout *f,
 				     struct sk_buff *skb,
 				     unsigned int num)
@@ -1441,6 +1464,9 @@ static int packet_rcv_fanout(struct sk_buff *skb, struct net_device *dev,
 	case PACKET_FANOUT_QM:
 		idx = fanout_demux_qm(f, skb, num);
 		break;
+	case PACKET_FANOUT_CPU_RING:
+		idx = fanout_demux_cpu_ring(f, skb, num);
+		break;
 	case PACKET_FANOUT_ROLLOVER:
 		idx = fanout_demux_rollover(f, skb, 0, false, num);
 		break;
@@ -1462,6 +1488,27 @@ EXPORT_SYMBOL_GPL(fanout_mutex);
 static LIST_HEAD(fanout_list);
 static u16 fanout_next_id;
 
+/* PACKET_FANOUT_CPU_RING: for each CPU, the index of the member whose ring
+ * is bound to it, PACKET_FANOUT_MAX if there is none. Must be called with
+ * f->lock held whenever the members move around in f->arr.
+ */
+static void __fanout_update_cpu_map(struct packet_fanout *f)
+{
+	unsigned int i;
+	int cpu;
+
+	if (f->type != PACKET_FANOUT_CPU_RING)
+		return;
+
+	for_each_possible_cpu(cpu)
+		WRITE_ONCE(f->cpu_map[cpu], PACKET_FANOUT_MAX);
+	for (i = 0; i < f->num_members; i++) {
+		cpu = pkt_sk(f->arr[i])->ring_cpu;
+		if (cpu >= 0)
+			WRITE_ONCE(f->cpu_map[cpu], i);
+	}
+}
+
 static void __fanout_link(struct sock *sk, struct packet_sock *po)
 {
 	struct packet_fanout *f = po->fanout;
@@ -1470,6 +1517,7 @@ static void __fanout_link(struct sock *sk, struct packet_sock *po)
 	f->arr[f->num_members] = sk;
 	smp_wmb();
 	f->num_members++;
+	__fanout_update_cpu_map(f);
 	if (f->num_members == 1)
 		dev_add_pack(&f->prot_hook);
 	spin_unlock(&f->lock);
@@ -1488,6 +1536,7 @@ static void __fanout_unlink(struct sock *sk, struct packet_sock *po)
 	BUG_ON(i >= f->num_members);
 	f->arr[i] = f->arr[f->num_members - 1];
 	f->num_members--;
+	__fanout_update_cpu_map(f);
 	if (f->num_members == 0)
 		__dev_remove_pack(&f->prot_hook);
 	spin_unlock(&f->lock);
@@ -1591,6 +1640,10 @@ static void fanout_release_data(struct packet_fanout *f)
 	case PACKET_FANOUT_CBPF:
 	case PACKET_FANOUT_EBPF:
 		__fanout_set_data_bpf(f, NULL);
+		break;
+	case PACKET_FANOUT_CPU_RING:
+		kfree(f->cpu_map);
+		break;
 	}
 }
 
@@ -1644,6 +1697,7 @@ static int fanout_add(struct sock *sk, u16 id, u16 type_flags)
 	case PACKET_FANOUT_QM:
 	case PACKET_FANOUT_CBPF:
 	case PACKET_FANOUT_EBPF:
+	case PACKET_FANOUT_CPU_RING:
 		break;
 	default:
 		return -EINVAL;
@@ -1699,6 +1753,15 @@ static int fanout_add(struct sock *sk, u16 id, u16 type_flags)
 		match->id = id;
 		match->type = type;
 		match->flags = flags;
+		if (type == PACKET_FANOUT_CPU_RING) {
+			match->cpu_map = kmalloc_array(nr_cpu_ids,
+						       sizeof(*match->cpu_map),
+						       GFP_KERNEL);
+			if (!match->cpu_map) {
+				kfree(match);
+				goto out;
+			}
+		}
 		INIT_LIST_HEAD(&match->list);
 		spin_lock_init(&match->lock);
 		refcount_set(&match->sk_ref, 0);
@@ -1732,6 +1795,7 @@ static int fanout_add(struct sock *sk, u16 id, u16 type_flags)
 
 	if (err && !refcount_read(&match->sk_ref)) {
 		list_del(&match->list);
+		fanout_release_data(match);
 		kfree(match);
 	}
 
@@ -2399,6 +2463,11 @@ static void tpacket_destruct_skb(struct sk_buff *skb)
 
 		ts = __packet_set_timestamp(po, ph, skb);
 		__packet_set_status(po, ph, TP_STATUS_AVAILABLE | ts);
+
+		/* Only a blocking sender cares, and then it is asleep */
+		if (READ_ONCE(po->wait_on_complete) &&
+		    !packet_read_pending(&po->tx_ring))
+			complete(&po->skb_completion);
 	}
 
 	sock_wfree(skb);
@@ -2592,6 +2661,124 @@ static int tpacket_parse_header(struct packet_sock *po, void *frame,
 	return tp_len;
 }
 
+#define PACKET_TX_BATCH	16
+
+/* TX_RING frames of a qdisc bypass socket that are ready for the driver */
+struct packet_tx_batch {
+	struct sk_buff		*head;
+	struct sk_buff		**tail;
+	unsigned int		len;
+	u16			queue;
+	unsigned int		ring_head[PACKET_TX_BATCH];
+};
+
+static void tpacket_snd_batch_init(struct packet_tx_batch *b)
+{
+	b->head = NULL;
+	b->tail = &b->head;
+	b->len = 0;
+}
+
+/* Hands a frame that was not sent back to user space as a send request */
+static void tpacket_snd_unwind(struct packet_sock *po, struct sk_buff *skb)
+{
+	void *ph = skb_shinfo(skb)->destructor_arg;
+
+	__packet_set_status(po, ph, TP_STATUS_SEND_REQUEST);
+	packet_dec_pending(&po->tx_ring);
+	skb->destructor = sock_wfree;
+	consume_skb(skb);
+}
+
+/* Sends the batch under a single queue lock, with xmit_more set on all but
+ * the last frame. Like packet_direct_xmit(), frames the driver does not take
+ * stay send requests, and the ring head goes back to the first of them.
+ */
+static int tpacket_snd_flush(struct packet_sock *po, struct net_device *dev,
+			     struct packet_tx_batch *b)
+{
+	struct sk_buff *skb = b->head, *next;
+	unsigned int nr = b->len, left = 0;
+	struct netdev_queue *txq;
+	int ret;
+
+	if (!nr)
+		return 0;
+	tpacket_snd_batch_init(b);
+
+	if (likely(netif_running(dev) && netif_carrier_ok(dev))) {
+		txq = netdev_get_tx_queue(dev, b->queue);
+
+		local_bh_disable();
+		HARD_TX_LOCK(dev, txq, smp_processor_id());
+		while (skb && !netif_xmit_frozen_or_drv_stopped(txq)) {
+			next = skb->next;
+			skb->next = NULL;
+			ret = netdev_start_xmit(skb, dev, txq, next != NULL);
+			if (unlikely(!dev_xmit_complete(ret))) {
+				skb->next = next;
+				break;
+			}
+			skb = next;
+		}
+		HARD_TX_UNLOCK(dev, txq);
+		local_bh_enable();
+	} else {
+		atomic_long_add(nr, &dev->tx_dropped);
+	}
+
+	if (likely(!skb))
+		return 0;
+
+	for (; skb; skb = next, left++) {
+		next = skb->next;
+		skb->next = NULL;
+		tpacket_snd_unwind(po, skb);
+	}
+	po->tx_ring.head = b->ring_head[nr - left];
+	return -ENOBUFS;
+}
+
+/* Queues the skb of the frame at the ring head, which it then moves past */
+static int tpacket_snd_batch(struct packet_sock *po, struct net_device *dev,
+			     struct packet_tx_batch *b, struct sk_buff *skb,
+			     void *ph)
+{
+	struct sk_buff *orig_skb = skb;
+	bool again = false;
+	u16 queue;
+	int err;
+
+	queue = packet_pick_tx_queue(skb);
+	if (b->len && queue != b->queue) {
+		err = tpacket_snd_flush(po, dev, b);
+		if (unlikely(err)) {
+			tpacket_snd_unwind(po, skb);
+			return err;
+		}
+	}
+
+	skb = validate_xmit_skb_list(skb, dev, &again);
+	if (unlikely(skb != orig_skb)) {
+		/* Dropped, and the frame already destructed */
+		atomic_long_inc(&dev->tx_dropped);
+		kfree_skb_list(skb);
+		__packet_set_status(po, ph, TP_STATUS_SEND_REQUEST);
+		return tpacket_snd_flush(po, dev, b) ?: -ENOBUFS;
+	}
+
+	skb_set_queue_mapping(skb, queue);
+	b->queue = queue;
+	b->ring_head[b->len++] = po->tx_ring.head;
+	*b->tail = skb;
+	b->tail = &skb->next;
+	packet_increment_head(&po->tx_ring);
+
+	if (b->len == PACKET_TX_BATCH)
+		return tpacket_snd_flush(po, dev, b);
+	return 0;
+}
+
 static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 {
 	struct sk_buff *skb;
@@ -2609,6 +2796,11 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 	int len_sum = 0;
 	int status = TP_STATUS_AVAILABLE;
 	int hlen, tlen, copylen = 0;
+	bool batching = packet_use_direct_xmit(po);
+	struct packet_tx_batch batch;
+	long timeo = 0;
+
+	tpacket_snd_batch_init(&batch);
 
 	mutex_lock(&po->pg_vec_lock);
 
@@ -2651,12 +2843,31 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 	if ((size_max > dev->mtu + reserve + VLAN_HLEN) && !po->has_vnet_hdr)
 		size_max = dev->mtu + reserve + VLAN_HLEN;
 
+	if (need_wait) {
+		reinit_completion(&po->skb_completion);
+		WRITE_ONCE(po->wait_on_complete, 1);
+		timeo = sock_sndtimeo(&po->sk, false);
+	}
+
 	do {
 		ph = packet_current_frame(po, &po->tx_ring,
 					  TP_STATUS_SEND_REQUEST);
 		if (unlikely(ph == NULL)) {
-			if (need_wait && need_resched())
-				schedule();
+			err = tpacket_snd_flush(po, dev, &batch);
+			if (unlikely(err))
+				goto out_put;
+			/* Sleep until the frames in flight are completed,
+			 * instead of polling the pending count.
+			 */
+			if (need_wait && packet_read_pending(&po->tx_ring)) {
+				timeo = wait_for_completion_interruptible_timeout(
+						&po->skb_completion, timeo);
+				if (timeo <= 0) {
+					err = !timeo ? -ETIMEDOUT : -ERESTARTSYS;
+					goto out_put;
+				}
+			}
+			/* check for additional frames */
 			continue;
 		}
 
@@ -2703,6 +2914,14 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 		if (unlikely(tp_len < 0)) {
 tpacket_error:
 			if (po->tp_loss) {
+				/* Frames handed back must not end up behind
+				 * the skipped one.
+				 */
+				err = tpacket_snd_flush(po, dev, &batch);
+				if (unlikely(err)) {
+					kfree_skb(skb);
+					goto out_put;
+				}
 				__packet_set_status(po, ph,
 						TP_STATUS_AVAILABLE);
 				packet_increment_head(&po->tx_ring);
@@ -2728,6 +2947,14 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 		packet_inc_pending(&po->tx_ring);
 
 		status = TP_STATUS_SEND_REQUEST;
+		if (batching) {
+			err = tpacket_snd_batch(po, dev, &batch, skb, ph);
+			if (unlikely(err))
+				goto out_put;
+			len_sum += tp_len;
+			continue;
+		}
+
 		err = po->xmit(skb);
 		if (unlikely(err > 0)) {
 			err = net_xmit_errno(err);
@@ -2761,6 +2988,11 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 	__packet_set_status(po, ph, status);
 	kfree_skb(skb);
 out_put:
+	/* Frames queued before an error still go out */
+	if (unlikely(batch.len) && tpacket_snd_flush(po, dev, &batch) &&
+	    err >= 0)
+		err = -ENOBUFS;
+	WRITE_ONCE(po->wait_on_complete, 0);
 	dev_put(dev);
 out:
 	mutex_unlock(&po->pg_vec_lock);
@@ -3210,6 +3442,8 @@ static int packet_create(struct net *net, struct socket *sock, int protocol,
 	sk->sk_family = PF_PACKET;
 	po->num = proto;
 	po->xmit = dev_queue_xmit;
+	po->ring_cpu = -1;
+	init_completion(&po->skb_completion);
 
 	err = packet_alloc_pending(po);
 	if (err)
@@ -3839,6 +4073,33 @@ packet_setsockopt(struct socket *sock, int level, int optname, char __user *optv
 		po->xmit = val ? packet_direct_xmit : dev_queue_xmit;
 		return 0;
 	}
+	case PACKET_RING_CPU:
+	{
+		int val;
+
+		if (optlen != sizeof(val))
+			return -EINVAL;
+		if (copy_from_user(&val, optval, sizeof(val)))
+			return -EFAULT;
+		if (val < -1 || val >= (int)nr_cpu_ids ||
+		    (val >= 0 && !cpu_possible(val)))
+			return -EINVAL;
+
+		/* The binding is read when the rings are allocated and when
+		 * the socket joins a fanout group.
+		 */
+		mutex_lock(&fanout_mutex);
+		lock_sock(sk);
+		if (po->rx_ring.pg_vec || po->tx_ring.pg_vec || po->fanout) {
+			ret = -EBUSY;
+		} else {
+			po->ring_cpu = val;
+			ret = 0;
+		}
+		release_sock(sk);
+		mutex_unlock(&fanout_mutex);
+		return ret;
+	}
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -3946,6 +4207,9 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 	case PACKET_QDISC_BYPASS:
 		val = packet_use_direct_xmit(po);
 		break;
+	case PACKET_RING_CPU:
+		val = po->ring_cpu;
+		break;
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -4158,24 +4422,36 @@ static void free_pg_vec(struct pgv *pg_vec, unsigned int order,
 	kfree(pg_vec);
 }
 
-static char *alloc_one_pg_vec_page(unsigned long order)
+static char *pg_vec_get_free_pages(gfp_t gfp_flags, unsigned long order,
+				   int node)
+{
+	struct page *page;
+
+	if (node == NUMA_NO_NODE)
+		return (char *) __get_free_pages(gfp_flags, order);
+
+	page = alloc_pages_node(node, gfp_flags, order);
+	return page ? page_address(page) : NULL;
+}
+
+static char *alloc_one_pg_vec_page(unsigned long order, int node)
 {
 	char *buffer;
 	gfp_t gfp_flags = GFP_KERNEL | __GFP_COMP |
 			  __GFP_ZERO | __GFP_NOWARN | __GFP_NORETRY;
 
-	buffer = (char *) __get_free_pages(gfp_flags, order);
+	buffer = pg_vec_get_free_pages(gfp_flags, order, node);
 	if (buffer)
 		return buffer;
 
 	/* __get_free_pages failed, fall back to vmalloc */
-	buffer = vzalloc(array_size((1 << order), PAGE_SIZE));
+	buffer = vzalloc_node(array_size((1 << order), PAGE_SIZE), node);
 	if (buffer)
 		return buffer;
 
 	/* vmalloc failed, lets dig into swap here */
 	gfp_flags &= ~__GFP_NORETRY;
-	buffer = (char *) __get_free_pages(gfp_flags, order);
+	buffer = pg_vec_get_free_pages(gfp_flags, order, node);
 	if (buffer)
 		return buffer;
 
@@ -4183,7 +4459,7 @@ static char *alloc_one_pg_vec_page(unsigned long order)
 	return NULL;
 }
 
-static struct pgv *alloc_pg_vec(struct tpacket_req *req, int order)
+static struct pgv *alloc_pg_vec(struct tpacket_req *req, int order, int node)
 {
 	unsigned int block_nr = req->tp_block_nr;
 	struct pgv *pg_vec;
@@ -4194,7 +4470,7 @@ static struct pgv *alloc_pg_vec(struct tpacket_req *req, int order)
 		goto out;
 
 	for (i = 0; i < block_nr; i++) {
-		pg_vec[i].buffer = alloc_one_pg_vec_page(order);
+		pg_vec[i].buffer = alloc_one_pg_vec_page(order, node);
 		if (unlikely(!pg_vec[i].buffer))
 			goto out_free_pgvec;
 	}
@@ -4278,7 +4554,9 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 
 		err = -ENOMEM;
 		order = get_order(req->tp_block_size);
-		pg_vec = alloc_pg_vec(req, order);
+		/* Blocks of a bound ring live next to its CPU */
+		pg_vec = alloc_pg_vec(req, order, po->ring_cpu >= 0 ?
+				      cpu_to_node(po->ring_cpu) : NUMA_NO_NODE);
 		if (unlikely(!pg_vec))
 			goto out;
 		switch (po->tp_version) {
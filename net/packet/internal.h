@@ -2,6 +2,7 @@
 #ifndef __PACKET_INTERNAL_H__
 #define __PACKET_INTERNAL_H__
 
+#include <linux/completion.h>
 #include <linux/refcount.h>
 
 struct packet_mclist {
@@ -47,6 +48,7 @@ struct tpacket_kbdq_core {
 	unsigned short  retire_blk_tov;
 	unsigned short  version;
 	unsigned long	tov_in_jiffies;
+	int		retire_blk_cpu;	/* -1 if the ring is not bound */
 
 	/* timer to retire an outstanding block */
 	struct timer_list retire_blk_timer;
@@ -85,6 +87,7 @@ struct packet_fanout {
 	union {
 		atomic_t		rr_cur;
 		struct bpf_prog __rcu	*bpf_prog;
+		u16			*cpu_map;
 	};
 	struct list_head	list;
 	struct sock		*arr[PACKET_FANOUT_MAX];
@@ -119,6 +122,9 @@ struct packet_sock {
 				tp_loss:1,
 				tp_tx_has_off:1;
 	int			pressure;
+	int			ring_cpu;	/* PACKET_RING_CPU, or -1 */
+	unsigned int		wait_on_complete;
+	struct completion	skb_completion;
 	int			ifindex;	/* bound device		*/
 	__be16			num;
 	struct packet_rollover	*rollover;
@@ -70,6 +70,14 @@ int xdp_umem_assign_dev(struct xdp_umem *umem, struct net_device *dev,
 	if (force_zc && force_copy)
 		return -EINVAL;
 
+	if (flags & XDP_USE_NEED_WAKEUP) {
+		umem->flags |= XDP_UMEM_USES_NEED_WAKEUP;
+		/* Tx needs to be kicked the first time, also for drivers
+		 * that never clear the flag. xsk_bind() sets it in the ring.
+		 */
+		umem->need_wakeup = XDP_WAKEUP_TX;
+	}
+
 	if (force_copy)
 		return 0;
 
@@ -30,6 +30,20 @@
 
 #define TX_BATCH_SIZE 16
 
+/* struct xdp_ring_offset before the flags field was added */
+struct xdp_ring_offset_v1 {
+	__u64 producer;
+	__u64 consumer;
+	__u64 desc;
+};
+
+struct xdp_mmap_offsets_v1 {
+	struct xdp_ring_offset_v1 rx;
+	struct xdp_ring_offset_v1 tx;
+	struct xdp_ring_offset_v1 fr;
+	struct xdp_ring_offset_v1 cr;
+};
+
 static struct xdp_sock *xdp_sk(struct sock *sk)
 {
 	return (struct xdp_sock *)sk;
@@ -53,6 +67,62 @@ void xsk_umem_discard_addr(struct xdp_umem *umem)
 }
 EXPORT_SYMBOL(xsk_umem_discard_addr);
 
+void xsk_set_rx_need_wakeup(struct xdp_umem *umem)
+{
+	if (umem->need_wakeup & XDP_WAKEUP_RX)
+		return;
+
+	umem->fq->ring->flags |= XDP_RING_NEED_WAKEUP;
+	umem->need_wakeup |= XDP_WAKEUP_RX;
+}
+EXPORT_SYMBOL(xsk_set_rx_need_wakeup);
+
+void xsk_set_tx_need_wakeup(struct xdp_umem *umem)
+{
+	struct xdp_sock *xs;
+
+	if (umem->need_wakeup & XDP_WAKEUP_TX)
+		return;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(xs, &umem->xsk_list, list) {
+		if (xs->tx)
+			xs->tx->ring->flags |= XDP_RING_NEED_WAKEUP;
+	}
+	rcu_read_unlock();
+
+	umem->need_wakeup |= XDP_WAKEUP_TX;
+}
+EXPORT_SYMBOL(xsk_set_tx_need_wakeup);
+
+void xsk_clear_rx_need_wakeup(struct xdp_umem *umem)
+{
+	if (!(umem->need_wakeup & XDP_WAKEUP_RX))
+		return;
+
+	umem->fq->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+	umem->need_wakeup &= ~XDP_WAKEUP_RX;
+}
+EXPORT_SYMBOL(xsk_clear_rx_need_wakeup);
+
+void xsk_clear_tx_need_wakeup(struct xdp_umem *umem)
+{
+	struct xdp_sock *xs;
+
+	if (!(umem->need_wakeup & XDP_WAKEUP_TX))
+		return;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(xs, &umem->xsk_list, list) {
+		if (xs->tx)
+			xs->tx->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+	}
+	rcu_read_unlock();
+
+	umem->need_wakeup &= ~XDP_WAKEUP_TX;
+}
+EXPORT_SYMBOL(xsk_clear_tx_need_wakeup);
+
 static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 {
 	void *buffer;
@@ -193,6 +263,27 @@ static int xsk_zc_xmit(struct sock *sk)
 	return dev->netdev_ops->ndo_xsk_async_xmit(dev, xs->queue_id);
 }
 
+/* Copy mode counterpart of xsk_{set,clear}_tx_need_wakeup() */
+static void xsk_generic_set_tx_need_wakeup(struct xdp_sock *xs,
+					   bool need_wakeup)
+{
+	if (xs->tx_need_wakeup == need_wakeup)
+		return;
+
+	WRITE_ONCE(xs->tx_need_wakeup, need_wakeup);
+	if (need_wakeup)
+		xs->tx->ring->flags |= XDP_RING_NEED_WAKEUP;
+	else
+		xs->tx->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+}
+
+static void xsk_generic_schedule_tx(struct xdp_sock *xs)
+{
+	sock_hold(&xs->sk);
+	if (!schedule_work(&xs->tx_work))
+		sock_put(&xs->sk);
+}
+
 static void xsk_destruct_skb(struct sk_buff *skb)
 {
 	u64 addr = (u64)(long)skb_shinfo(skb)->destructor_arg;
@@ -203,77 +294,233 @@ static void xsk_destruct_skb(struct sk_buff *skb)
 	WARN_ON_ONCE(xskq_produce_addr(xs->umem->cq, addr));
 	spin_unlock_irqrestore(&xs->tx_completion_lock, flags);
 
+	/* The kernel promised to keep going without a kick. The socket may
+	 * already be released, with only its in-flight frames keeping it.
+	 */
+	if (xsk_umem_uses_need_wakeup(xs->umem) &&
+	    !READ_ONCE(xs->tx_need_wakeup) &&
+	    refcount_inc_not_zero(&xs->sk.sk_refcnt) &&
+	    !schedule_work(&xs->tx_work))
+		sock_put(&xs->sk);
+
 	sock_wfree(skb);
 }
 
-static int xsk_generic_xmit(struct sock *sk, struct msghdr *m,
-			    size_t total_len)
+static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
+				     struct xdp_desc *desc, int *err)
 {
-	u32 max_batch = TX_BATCH_SIZE;
-	struct xdp_sock *xs = xdp_sk(sk);
-	bool sent_frame = false;
-	struct xdp_desc desc;
+	struct sock *sk = &xs->sk;
 	struct sk_buff *skb;
-	int err = 0;
+	char *buffer;
+	u32 len;
 
-	mutex_lock(&xs->mutex);
+	len = desc->len;
+	skb = sock_alloc_send_skb(sk, len, 1, err);
+	if (unlikely(!skb)) {
+		*err = -EAGAIN;
+		return NULL;
+	}
 
-	while (xskq_peek_desc(xs->tx, &desc)) {
-		char *buffer;
-		u64 addr;
-		u32 len;
+	skb_put(skb, len);
+	buffer = xdp_umem_get_data(xs->umem, desc->addr);
+	*err = skb_store_bits(skb, 0, buffer, len);
+	if (unlikely(*err)) {
+		kfree_skb(skb);
+		return NULL;
+	}
 
-		if (max_batch-- == 0) {
-			err = -EAGAIN;
-			goto out;
-		}
+	skb->dev = xs->dev;
+	skb->priority = sk->sk_priority;
+	skb->mark = sk->sk_mark;
+	skb_set_queue_mapping(skb, xs->queue_id);
+	skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
+	skb->destructor = xsk_destruct_skb;
 
-		if (xskq_reserve_addr(xs->umem->cq))
-			goto out;
+	return skb;
+}
 
-		if (xs->queue_id >= xs->dev->real_num_tx_queues)
-			goto out;
+/* Builds skbs for up to @budget descriptors and hands them to the driver
+ * as one list, under a single queue lock and with xmit_more set on all but
+ * the last one. Only the first peek may refresh the window of the Tx ring,
+ * so the descriptors of the skbs the driver does not take can be handed
+ * back, together with their completion ring slots.
+ *
+ * The skbs are linear and request no offloads, so unlike dev_direct_xmit()
+ * there is nothing for validate_xmit_skb() to do.
+ */
+static int xsk_generic_xmit_batch(struct xdp_sock *xs, u32 budget,
+				  u32 *nb_sent)
+{
+	struct sk_buff *list = NULL, **tail = &list, *skb;
+	u64 invalid_descs[TX_BATCH_SIZE];
+	u32 cons_tail[TX_BATCH_SIZE];
+	struct net_device *dev = xs->dev;
+	struct xsk_queue *tx = xs->tx;
+	struct netdev_queue *txq;
+	u32 nb_skbs = 0, left = 0;
+	struct xdp_desc desc;
+	int err = 0, ret;
 
-		len = desc.len;
-		skb = sock_alloc_send_skb(sk, len, 1, &err);
-		if (unlikely(!skb)) {
-			err = -EAGAIN;
-			goto out;
+	*nb_sent = 0;
+
+	while (nb_skbs < budget) {
+		cons_tail[nb_skbs] = tx->cons_tail;
+		invalid_descs[nb_skbs] = tx->invalid_descs;
+		if (!(nb_skbs ? xskq_validate_desc(tx, &desc) :
+				xskq_peek_desc(tx, &desc)))
+			break;
+
+		if (xskq_reserve_addr(xs->umem->cq)) {
+			err = -ENOSPC;
+			break;
 		}
 
-		skb_put(skb, len);
-		addr = desc.addr;
-		buffer = xdp_umem_get_data(xs->umem, addr);
-		err = skb_store_bits(skb, 0, buffer, len);
-		if (unlikely(err)) {
-			kfree_skb(skb);
-			goto out;
+		skb = xsk_build_skb(xs, &desc, &err);
+		if (unlikely(!skb)) {
+			xskq_cancel_addr_n(xs->umem->cq, 1);
+			break;
 		}
 
-		skb->dev = xs->dev;
-		skb->priority = sk->sk_priority;
-		skb->mark = sk->sk_mark;
-		skb_shinfo(skb)->destructor_arg = (void *)(long)addr;
-		skb->destructor = xsk_destruct_skb;
+		xskq_discard_desc(tx);
+		*tail = skb;
+		tail = &skb->next;
+		nb_skbs++;
+	}
 
-		err = dev_direct_xmit(skb, xs->queue_id);
-		xskq_discard_desc(xs->tx);
-		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP || err == NETDEV_TX_BUSY) {
-			/* SKB completed but not sent */
-			err = -EBUSY;
-			goto out;
+	if (!list)
+		return err;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev))) {
+		/* SKBs completed but not sent */
+		atomic_long_add(nb_skbs, &dev->tx_dropped);
+		kfree_skb_list(list);
+		return -EBUSY;
+	}
+
+	txq = netdev_get_tx_queue(dev, xs->queue_id);
+	ret = NETDEV_TX_BUSY;
+
+	local_bh_disable();
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	if (!netif_xmit_frozen_or_drv_stopped(txq))
+		list = dev_hard_start_xmit(list, dev, txq, &ret);
+	HARD_TX_UNLOCK(dev, txq);
+	local_bh_enable();
+
+	while (list) {
+		skb = list;
+		list = skb->next;
+		skb->next = NULL;
+		/* Not taken by the driver, free it without completing it */
+		skb->destructor = sock_wfree;
+		consume_skb(skb);
+		left++;
+	}
+
+	if (left) {
+		xskq_rewind_desc(tx, cons_tail[nb_skbs - left],
+				 invalid_descs[nb_skbs - left]);
+		xskq_cancel_addr_n(xs->umem->cq, left);
+		err = -EAGAIN;
+	}
+
+	*nb_sent = nb_skbs - left;
+	return err;
+}
+
+/* In need_wakeup mode the kernel keeps the Tx ring going for as long as it
+ * can: from the tx work when a kick ran out of budget, and from the
+ * completion of the frames in flight when the driver was busy or the send
+ * buffer full. The flag only asks for a kick when neither will happen.
+ */
+static void xsk_generic_tx_done(struct xdp_sock *xs, int err, bool more,
+				bool drained)
+{
+	struct xdp_desc desc;
+
+	if (err == -EAGAIN && more) {
+		xsk_generic_schedule_tx(xs);
+		return;
+	}
+
+	if (err == -EAGAIN && sk_wmem_alloc_get(&xs->sk))
+		return;
+
+	xsk_generic_set_tx_need_wakeup(xs, true);
+	if (!drained)
+		return;
+
+	/* Pairs with userspace producing and then reading the flag */
+	smp_mb();
+	if (xskq_peek_desc(xs->tx, &desc)) {
+		xsk_generic_set_tx_need_wakeup(xs, false);
+		xsk_generic_schedule_tx(xs);
+	}
+}
+
+static int xsk_generic_xmit(struct sock *sk)
+{
+	u32 budget = TX_BATCH_SIZE, nb_sent;
+	struct xdp_sock *xs = xdp_sk(sk);
+	bool sent_frame = false;
+	bool drained = false;
+	bool more = false;
+	struct xdp_desc desc;
+	int err = 0;
+
+	mutex_lock(&xs->mutex);
+
+	/* The tx work may run after the socket was released */
+	if (unlikely(!xs->dev)) {
+		mutex_unlock(&xs->mutex);
+		return -ENXIO;
+	}
+
+	if (xsk_umem_uses_need_wakeup(xs->umem))
+		xsk_generic_set_tx_need_wakeup(xs, false);
+
+	if (xs->queue_id >= xs->dev->real_num_tx_queues)
+		goto out;
+
+	while (budget) {
+		err = xsk_generic_xmit_batch(xs, budget, &nb_sent);
+		if (nb_sent)
+			sent_frame = true;
+		if (err)
+			break;
+		if (!nb_sent) {
+			drained = true;
+			break;
 		}
+		budget -= nb_sent;
+	}
 
-		sent_frame = true;
+	if (!budget) {
+		if (xskq_peek_desc(xs->tx, &desc)) {
+			err = -EAGAIN;
+			more = true;
+		} else {
+			drained = true;
+		}
 	}
 
 out:
+	if (xsk_umem_uses_need_wakeup(xs->umem))
+		xsk_generic_tx_done(xs, err, more, drained);
+
 	if (sent_frame)
 		sk->sk_write_space(sk);
 
 	mutex_unlock(&xs->mutex);
-	return err;
+	return err == -ENOSPC ? 0 : err;
+}
+
+static void xsk_generic_tx_work(struct work_struct *work)
+{
+	struct xdp_sock *xs = container_of(work, struct xdp_sock, tx_work);
+
+	xsk_generic_xmit(&xs->sk);
+	sock_put(&xs->sk);
 }
 
 static int xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len)
@@ -291,7 +538,7 @@ static int xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len)
 	if (need_wait)
 		return -EOPNOTSUPP;
 
-	return (xs->zc) ? xsk_zc_xmit(sk) : xsk_generic_xmit(sk, m, total_len);
+	return (xs->zc) ? xsk_zc_xmit(sk) : xsk_generic_xmit(sk);
 }
 
 static unsigned int xsk_poll(struct file *file, struct socket *sock,
@@ -301,6 +548,17 @@ static unsigned int xsk_poll(struct file *file, struct socket *sock,
 	struct sock *sk = sock->sk;
 	struct xdp_sock *xs = xdp_sk(sk);
 
+	if (xs->dev && (xs->dev->flags & IFF_UP) &&
+	    xsk_umem_uses_need_wakeup(xs->umem)) {
+		/* Poll drives Tx also in copy mode */
+		if (xs->zc) {
+			if (READ_ONCE(xs->umem->need_wakeup))
+				xsk_zc_xmit(sk);
+		} else if (xs->tx && READ_ONCE(xs->tx_need_wakeup)) {
+			xsk_generic_xmit(sk);
+		}
+	}
+
 	if (xs->rx && !xskq_empty_desc(xs->rx))
 		mask |= POLLIN | POLLRDNORM;
 	if (xs->tx && !xskq_full_desc(xs->tx))
@@ -343,10 +601,16 @@ static int xsk_release(struct socket *sock)
 	local_bh_enable();
 
 	if (xs->dev) {
+		struct net_device *dev = xs->dev;
+
 		/* Wait for driver to stop using the xdp socket. */
 		synchronize_net();
-		dev_put(xs->dev);
+
+		/* The tx work checks this under the mutex */
+		mutex_lock(&xs->mutex);
 		xs->dev = NULL;
+		mutex_unlock(&xs->mutex);
+		dev_put(dev);
 	}
 
 	sock_orphan(sk);
@@ -420,7 +684,8 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 		struct xdp_sock *umem_xs;
 		struct socket *sock;
 
-		if ((flags & XDP_COPY) || (flags & XDP_ZEROCOPY)) {
+		if ((flags & XDP_COPY) || (flags & XDP_ZEROCOPY) ||
+		    (flags & XDP_USE_NEED_WAKEUP)) {
 			/* Cannot specify flags for shared sockets. */
 			err = -EINVAL;
 			goto out_unlock;
@@ -471,6 +736,11 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 	xs->queue_id = qid;
 	xskq_set_umem(xs->rx, &xs->umem->props);
 	xskq_set_umem(xs->tx, &xs->umem->props);
+	if (xs->tx && xsk_umem_uses_need_wakeup(xs->umem)) {
+		/* Nothing is sent before the first kick */
+		xs->tx_need_wakeup = true;
+		xs->tx->ring->flags |= XDP_RING_NEED_WAKEUP;
+	}
 	xdp_add_sk_umem(xs->umem, xs);
 
 out_unlock:
@@ -563,6 +833,14 @@ static int xsk_setsockopt(struct socket *sock, int level, int optname,
 	return -ENOPROTOOPT;
 }
 
+static void xsk_offsets_to_v1(struct xdp_ring_offset_v1 *v1,
+			      const struct xdp_ring_offset *off)
+{
+	v1->producer = off->producer;
+	v1->consumer = off->consumer;
+	v1->desc = off->desc;
+}
+
 static int xsk_getsockopt(struct socket *sock, int level, int optname,
 			  char __user *optval, int __user *optlen)
 {
@@ -603,22 +881,44 @@ static int xsk_getsockopt(struct socket *sock, int level, int optname,
 	{
 		struct xdp_mmap_offsets off;
 
-		if (len < sizeof(off))
+		if (len < sizeof(struct xdp_mmap_offsets_v1))
 			return -EINVAL;
 
 		off.rx.producer = offsetof(struct xdp_rxtx_ring, ptrs.producer);
 		off.rx.consumer = offsetof(struct xdp_rxtx_ring, ptrs.consumer);
 		off.rx.desc	= offsetof(struct xdp_rxtx_ring, desc);
+		off.rx.flags	= offsetof(struct xdp_rxtx_ring, ptrs.flags);
 		off.tx.producer = offsetof(struct xdp_rxtx_ring, ptrs.producer);
 		off.tx.consumer = offsetof(struct xdp_rxtx_ring, ptrs.consumer);
 		off.tx.desc	= offsetof(struct xdp_rxtx_ring, desc);
+		off.tx.flags	= offsetof(struct xdp_rxtx_ring, ptrs.flags);
 
 		off.fr.producer = offsetof(struct xdp_umem_ring, ptrs.producer);
 		off.fr.consumer = offsetof(struct xdp_umem_ring, ptrs.consumer);
 		off.fr.desc	= offsetof(struct xdp_umem_ring, desc);
+		off.fr.flags	= offsetof(struct xdp_umem_ring, ptrs.flags);
 		off.cr.producer = offsetof(struct xdp_umem_ring, ptrs.producer);
 		off.cr.consumer = offsetof(struct xdp_umem_ring, ptrs.consumer);
 		off.cr.desc	= offsetof(struct xdp_umem_ring, desc);
+		off.cr.flags	= offsetof(struct xdp_umem_ring, ptrs.flags);
+
+		if (len < sizeof(off)) {
+			/* Binaries built before the flags field was added */
+			struct xdp_mmap_offsets_v1 off_v1;
+
+			xsk_offsets_to_v1(&off_v1.rx, &off.rx);
+			xsk_offsets_to_v1(&off_v1.tx, &off.tx);
+			xsk_offsets_to_v1(&off_v1.fr, &off.fr);
+			xsk_offsets_to_v1(&off_v1.cr, &off.cr);
+
+			len = sizeof(off_v1);
+			if (copy_to_user(optval, &off_v1, len))
+				return -EFAULT;
+			if (put_user(len, optlen))
+				return -EFAULT;
+
+			return 0;
+		}
 
 		len = sizeof(off);
 		if (copy_to_user(optval, &off, len))
@@ -749,6 +1049,7 @@ static int xsk_create(struct net *net, struct socket *sock, int protocol,
 	xs = xdp_sk(sk);
 	mutex_init(&xs->mutex);
 	spin_lock_init(&xs->tx_completion_lock);
+	INIT_WORK(&xs->tx_work, xsk_generic_tx_work);
 
 	local_bh_disable();
 	sock_prot_inuse_add(net, &xsk_proto, 1);
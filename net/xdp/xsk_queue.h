@@ -16,6 +16,7 @@
 struct xdp_ring {
 	u32 producer ____cacheline_aligned_in_smp;
 	u32 consumer ____cacheline_aligned_in_smp;
+	u32 flags;
 };
 
 /* Used for the RX and TX queues for packets */
@@ -166,6 +167,11 @@ static inline int xskq_reserve_addr(struct xsk_queue *q)
 	return 0;
 }
 
+static inline void xskq_cancel_addr_n(struct xsk_queue *q, u32 nb_entries)
+{
+	q->prod_head -= nb_entries;
+}
+
 /* Rx/Tx queue */
 
 static inline bool xskq_is_valid_desc(struct xsk_queue *q, struct xdp_desc *d)
@@ -218,6 +224,17 @@ static inline void xskq_discard_desc(struct xsk_queue *q)
 	q->cons_tail++;
 }
 
+/* Hands back the descriptors consumed since cons_tail was @cons_tail. Only
+ * valid as long as the window has not been refreshed since, as that
+ * publishes the consumer pointer to user space.
+ */
+static inline void xskq_rewind_desc(struct xsk_queue *q, u32 cons_tail,
+				    u64 invalid_descs)
+{
+	q->cons_tail = cons_tail;
+	q->invalid_descs = invalid_descs;
+}
+
 static inline int xskq_produce_batch_desc(struct xsk_queue *q,
 					  u64 addr, u32 len)
 {
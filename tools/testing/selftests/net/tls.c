@@ -9,8 +9,11 @@
 #include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <linux/cryptouser.h>
+#include <linux/netlink.h>
 #include <linux/tls.h>
 #include <linux/tcp.h>
 #include <linux/socket.h>
@@ -738,4 +741,204 @@ TEST_F(tls, control_msg)
 	EXPECT_EQ(memcmp(buf, test_str, send_len), 0);
 }
 
+/*
+ * A cryptd instance wrapping the generic gcm(aes) completes every request
+ * from a worker, so registering it with a high priority makes the sw
+ * records of new tls sockets go through the async paths.
+ */
+#define CRYPTD_GCM_AES "cryptd(gcm_base(ctr(aes-generic),ghash-generic))"
+#define CRYPTD_PRIORITY 10000
+#define CRYPTO_ALG_TYPE_AEAD 0x00000003
+#define CRYPTO_ALG_TYPE_MASK 0x0000000f
+#define TLS_AES_GCM_128_OVERHEAD (5 + 8 + 16)
+
+static int cryptd_gcm_aes(int type)
+{
+	struct sockaddr_nl nl = { .nl_family = AF_NETLINK };
+	struct {
+		struct nlmsghdr nlh;
+		struct crypto_user_alg alg;
+		struct nlattr nla;
+		__u32 priority;
+	} req;
+	struct {
+		struct nlmsghdr nlh;
+		struct nlmsgerr err;
+	} ack;
+	int fd, ret;
+
+	memset(&req, 0, sizeof(req));
+	req.nlh.nlmsg_len = sizeof(req);
+	req.nlh.nlmsg_type = type;
+	req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	strcpy(req.alg.cru_driver_name, CRYPTD_GCM_AES);
+	req.alg.cru_type = CRYPTO_ALG_TYPE_AEAD;
+	req.alg.cru_mask = CRYPTO_ALG_TYPE_MASK;
+	req.nla.nla_len = NLA_HDRLEN + sizeof(req.priority);
+	req.nla.nla_type = CRYPTOCFGA_PRIORITY_VAL;
+	req.priority = CRYPTD_PRIORITY;
+
+	fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_CRYPTO);
+	if (fd < 0)
+		return -errno;
+
+	ret = sendto(fd, &req, sizeof(req), 0, (struct sockaddr *)&nl,
+		     sizeof(nl));
+	if (ret == sizeof(req))
+		ret = recv(fd, &ack, sizeof(ack), 0);
+	if (ret < 0)
+		ret = -errno;
+	else if (ret < (int)sizeof(ack) || ack.nlh.nlmsg_type != NLMSG_ERROR)
+		ret = -EPROTO;
+	else
+		ret = ack.err.error;
+
+	close(fd);
+	return ret;
+}
+
+static void tcp_pair(struct __test_metadata *_metadata, int *fd, int *cfd)
+{
+	struct sockaddr_in addr;
+	socklen_t len;
+	int sfd, ret;
+
+	len = sizeof(addr);
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = 0;
+
+	*fd = socket(AF_INET, SOCK_STREAM, 0);
+	sfd = socket(AF_INET, SOCK_STREAM, 0);
+
+	ret = bind(sfd, &addr, sizeof(addr));
+	ASSERT_EQ(ret, 0);
+	ret = listen(sfd, 10);
+	ASSERT_EQ(ret, 0);
+
+	ret = getsockname(sfd, &addr, &len);
+	ASSERT_EQ(ret, 0);
+
+	ret = connect(*fd, &addr, sizeof(addr));
+	ASSERT_EQ(ret, 0);
+
+	*cfd = accept(sfd, &addr, &len);
+	ASSERT_GE(*cfd, 0);
+
+	close(sfd);
+}
+
+static void tls_attach(struct __test_metadata *_metadata, int fd, int dir)
+{
+	struct tls12_crypto_info_aes_gcm_128 tls12;
+	int ret;
+
+	memset(&tls12, 0, sizeof(tls12));
+	tls12.info.version = TLS_1_2_VERSION;
+	tls12.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+
+	ret = setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls"));
+	ASSERT_EQ(ret, 0);
+	ret = setsockopt(fd, SOL_TLS, dir, &tls12, sizeof(tls12));
+	ASSERT_EQ(ret, 0);
+}
+
+FIXTURE(tls_async)
+{
+	int fd, cfd;
+	bool nocryptd;
+};
+
+FIXTURE_SETUP(tls_async)
+{
+	int ret;
+
+	ret = cryptd_gcm_aes(CRYPTO_MSG_NEWALG);
+	self->nocryptd = ret && ret != -EEXIST;
+	if (self->nocryptd) {
+		printf("Failure registering %s (%d), skipping async tests\n",
+		       CRYPTD_GCM_AES, ret);
+		return;
+	}
+
+	tcp_pair(_metadata, &self->fd, &self->cfd);
+	tls_attach(_metadata, self->fd, TLS_TX);
+	tls_attach(_metadata, self->cfd, TLS_RX);
+}
+
+FIXTURE_TEARDOWN(tls_async)
+{
+	if (self->nocryptd)
+		return;
+
+	close(self->fd);
+	close(self->cfd);
+	cryptd_gcm_aes(CRYPTO_MSG_DELALG);
+}
+
+TEST_F(tls_async, multi_record)
+{
+	size_t send_len = 4 * TLS_PAYLOAD_MAX_LEN + 1000;
+	char *mem, *buf;
+	size_t i;
+
+	if (self->nocryptd)
+		return;
+
+	mem = malloc(send_len);
+	buf = malloc(send_len);
+	for (i = 0; i < send_len; i++)
+		mem[i] = rand();
+
+	/* one sendmsg spanning five records, then five small records */
+	EXPECT_EQ(send(self->fd, mem, send_len, 0), send_len);
+	EXPECT_EQ(recv(self->cfd, buf, send_len, MSG_WAITALL), send_len);
+	EXPECT_EQ(memcmp(mem, buf, send_len), 0);
+
+	for (i = 0; i < 5; i++)
+		EXPECT_EQ(send(self->fd, mem + i * 100, 100, 0), 100);
+	memset(buf, 0, send_len);
+	EXPECT_EQ(recv(self->cfd, buf, 500, MSG_WAITALL), 500);
+	EXPECT_EQ(memcmp(mem, buf, 500), 0);
+
+	free(mem);
+	free(buf);
+}
+
+TEST_F(tls_async, bad_tag)
+{
+	char const *test_str = "test_bad_tag";
+	int send_len = strlen(test_str) + 1;
+	int rec_len = send_len + TLS_AES_GCM_128_OVERHEAD;
+	char rec[2 * (sizeof("test_bad_tag") + TLS_AES_GCM_128_OVERHEAD)];
+	char buf[sizeof("test_bad_tag")];
+	int txfd, rawfd, rxfd, wfd;
+
+	if (self->nocryptd)
+		return;
+
+	/* Encrypt two records with the fixture's key and capture them raw */
+	tcp_pair(_metadata, &txfd, &rawfd);
+	tls_attach(_metadata, txfd, TLS_TX);
+	EXPECT_EQ(send(txfd, test_str, send_len, 0), send_len);
+	EXPECT_EQ(send(txfd, test_str, send_len, 0), send_len);
+	EXPECT_EQ(recv(rawfd, rec, 2 * rec_len, MSG_WAITALL), 2 * rec_len);
+
+	/* Corrupt the tag of the second one and feed both to a receiver */
+	rec[2 * rec_len - 1] ^= 0xff;
+	tcp_pair(_metadata, &wfd, &rxfd);
+	tls_attach(_metadata, rxfd, TLS_RX);
+	EXPECT_EQ(send(wfd, rec, 2 * rec_len, 0), 2 * rec_len);
+
+	EXPECT_EQ(recv(rxfd, buf, send_len, MSG_WAITALL), send_len);
+	EXPECT_EQ(memcmp(buf, test_str, send_len), 0);
+	EXPECT_EQ(recv(rxfd, buf, send_len, 0), -1);
+	EXPECT_EQ(errno, EBADMSG);
+
+	close(txfd);
+	close(rawfd);
+	close(wfd);
+	close(rxfd);
+}
+
 TEST_HARNESS_MAIN